@@ -0,0 +1,253 @@
+#include "Generator.hpp"
+
+#include "Analyzer.hpp"
+#include "Lexer.hpp"
+#include "Optimizer.hpp"
+#include "Parser.hpp"
+#include "codegen/Assembler.hpp"
+#include "codegen/Compiler.hpp"
+#include "codegen/Inliner.hpp"
+#include "codegen/Peephole.hpp"
+#include "codegen/SlotAllocator.hpp"
+#include "codegen/TailCalls.hpp"
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <new>
+
+// counting allocations means replacing the global operators with malloc and free, which gcc reports as mismatched.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+static std::atomic<size_t> allocations_g {};
+
+void* operator new(std::size_t size)
+{
+    allocations_g.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto pointer = std::malloc(size ? size : 1)) return pointer;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+static size_t count_nodes(std::unique_ptr<Node> const& node);
+
+static size_t count_nodes(std::vector<std::unique_ptr<Node>> const& nodes)
+{
+    auto count = 0zu;
+    for (auto const& node : nodes) count += count_nodes(node);
+    return count;
+}
+
+static size_t count_nodes(std::unique_ptr<Node> const& node)
+{
+    if (!node) return 0;
+
+    switch (node->node_type())
+    {
+    case Node::Type::DECLARATION: return 1 + count_nodes(static_cast<Declaration const*>(node.get())->scope);
+    case Node::Type::EXPRESSION: {
+        auto expression = static_cast<Expression const*>(node.get());
+
+        switch (expression->expr_type())
+        {
+        case Expression::Type::ARG: return 1 + count_nodes(static_cast<ArgExpr const*>(expression)->value);
+        case Expression::Type::ARITHMETIC: {
+            auto arithmeticExpr = static_cast<ArithmeticExpr const*>(expression);
+            return 1 + count_nodes(arithmeticExpr->lhs) + count_nodes(arithmeticExpr->rhs);
+        }
+        case Expression::Type::LOGICAL: {
+            auto logicalExpr = static_cast<LogicalExpr const*>(expression);
+            return 1 + count_nodes(logicalExpr->lhs) + count_nodes(logicalExpr->rhs);
+        }
+        case Expression::Type::CALL: return 1 + count_nodes(static_cast<CallExpr const*>(expression)->arguments);
+        case Expression::Type::LITERAL: return 1;
+        }
+
+        break;
+    }
+    case Node::Type::STATEMENT: {
+        auto statement = static_cast<Statement const*>(node.get());
+
+        switch (statement->stmt_type())
+        {
+        case Statement::Type::IF: {
+            auto ifStmt = static_cast<IfStmt const*>(statement);
+            return 1 + count_nodes(ifStmt->condition) + count_nodes(ifStmt->trueBranch) + count_nodes(ifStmt->falseBranch);
+        }
+        case Statement::Type::LET: return 1 + count_nodes(static_cast<LetStmt const*>(statement)->value);
+        case Statement::Type::RETURN: return 1 + count_nodes(static_cast<RetStmt const*>(statement)->value);
+        }
+
+        break;
+    }
+    case Node::Type::ERROR: return 1;
+    }
+
+    return 1;
+}
+
+struct Workload
+{
+    std::filesystem::path path {};
+    size_t bytes {};
+    std::vector<Token> tokens {};
+    std::unique_ptr<Node> ast {};
+    size_t nodes {};
+    Module module {};
+};
+
+// every stage is measured on its own, so the inputs of the later ones are prepared once up front.
+static Workload const& prepare_workload(benchmark::State const& state)
+{
+    static std::map<std::array<int64_t, 4>, Workload> workloads {};
+
+    std::array key { state.range(0), state.range(1), state.range(2), state.range(3) };
+
+    if (auto workload = workloads.find(key); workload != workloads.end())
+    {
+        return workload->second;
+    }
+
+    GeneratorOptions options {
+        .functions = size_t(key[0]),
+        .depth = size_t(key[1]),
+        .literalSize = size_t(key[2]),
+        .callDensity = size_t(key[3])
+    };
+
+    auto source = generate_program(options);
+
+    Workload workload {};
+
+    workload.path = std::filesystem::temp_directory_path() / fmt::format("xmlc-bench-{}-{}-{}-{}.xml", key[0], key[1], key[2], key[3]);
+    workload.bytes = source.size();
+
+    std::ofstream(workload.path, std::ios::binary) << source;
+
+    workload.tokens = tokenize(workload.path);
+    workload.ast = parse(workload.tokens).value();
+    workload.nodes = count_nodes(workload.ast);
+
+    analyze(workload.ast).value();
+    optimize(workload.ast).value();
+
+    workload.module = compile(workload.ast).value();
+    inline_functions(workload.module);
+    optimize_tail_calls(workload.module);
+    optimize_peephole(workload.module);
+    allocate_slots(workload.module);
+
+    return workloads.emplace(key, std::move(workload)).first->second;
+}
+
+static void report(benchmark::State& state, Workload const& workload, size_t allocations)
+{
+    auto iterations = double(state.iterations());
+
+    state.SetBytesProcessed(state.iterations() * int64_t(workload.bytes));
+
+    state.counters["tokens"] = benchmark::Counter(double(workload.tokens.size()) * iterations, benchmark::Counter::kIsRate);
+    state.counters["nodes"] = benchmark::Counter(double(workload.nodes) * iterations, benchmark::Counter::kIsRate);
+    state.counters["allocs"] = benchmark::Counter(double(allocations), benchmark::Counter::kAvgIterations);
+}
+
+static void tokenize_benchmark(benchmark::State& state)
+{
+    auto const& workload = prepare_workload(state);
+    auto allocations = allocations_g.load();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(tokenize(workload.path));
+    }
+
+    report(state, workload, allocations_g.load() - allocations);
+}
+
+static void parse_benchmark(benchmark::State& state)
+{
+    auto const& workload = prepare_workload(state);
+    auto allocations = allocations_g.load();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parse(workload.tokens));
+    }
+
+    report(state, workload, allocations_g.load() - allocations);
+}
+
+static void compile_benchmark(benchmark::State& state)
+{
+    auto const& workload = prepare_workload(state);
+    auto allocations = allocations_g.load();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(compile(workload.ast));
+    }
+
+    report(state, workload, allocations_g.load() - allocations);
+}
+
+static void assemble_benchmark(benchmark::State& state)
+{
+    auto const& workload = prepare_workload(state);
+    auto allocations = allocations_g.load();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(assemble(workload.module));
+    }
+
+    report(state, workload, allocations_g.load() - allocations);
+}
+
+static void print_benchmark(benchmark::State& state)
+{
+    auto const& workload = prepare_workload(state);
+    auto allocations = allocations_g.load();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(print_module(workload.module));
+    }
+
+    report(state, workload, allocations_g.load() - allocations);
+}
+
+static void workloads(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "functions", "depth", "literal", "calls" });
+
+    benchmark->Args({ 16, 1, 16, 4 });
+    benchmark->Args({ 256, 1, 16, 4 });
+    benchmark->Args({ 256, 8, 16, 4 });
+    benchmark->Args({ 256, 1, 256, 4 });
+    benchmark->Args({ 256, 1, 16, 32 });
+}
+
+BENCHMARK(tokenize_benchmark)->Apply(workloads);
+BENCHMARK(parse_benchmark)->Apply(workloads);
+BENCHMARK(compile_benchmark)->Apply(workloads);
+BENCHMARK(assemble_benchmark)->Apply(workloads);
+BENCHMARK(print_benchmark)->Apply(workloads);
+
+BENCHMARK_MAIN();
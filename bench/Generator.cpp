@@ -0,0 +1,93 @@
+#include "Generator.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+static std::string make_literal(size_t size, size_t seed)
+{
+    std::string literal {};
+    literal.reserve(size);
+
+    for (auto index = 0zu; index < std::max(size, 1zu); index += 1)
+    {
+        // the lexer only starts a literal on an alphanumeric character, so spaces never come first.
+        auto isSpace = index % 8 == 7;
+        literal += isSpace ? ' ' : char('a' + (seed + index) % 26);
+    }
+
+    return literal;
+}
+
+static void emit_line(std::string& source, size_t depth, std::string_view text)
+{
+    source.append(depth * 4, ' ');
+    source += text;
+    source += '\n';
+}
+
+// `caller` is the index of the function being generated, calls only ever go to functions declared before it.
+static void emit_call(std::string& source, GeneratorOptions const& options, size_t caller, size_t call, size_t depth)
+{
+    auto nesting = caller ? options.depth : 0;
+
+    emit_line(source, depth, R"(<call who="println">)");
+
+    for (auto level = 0zu; level < nesting; level += 1)
+    {
+        emit_line(source, depth + 1 + level * 2, "<arg>");
+        emit_line(source, depth + 2 + level * 2, fmt::format(R"(<call who="f{}">)", caller - 1 - level % caller));
+    }
+
+    auto innermost = depth + 1 + nesting * 2;
+
+    if (call % 2 == 0)
+    {
+        emit_line(source, innermost, fmt::format("<arg>{}</arg>", make_literal(options.literalSize, caller + call)));
+    }
+    else
+    {
+        emit_line(source, innermost, R"(<arg value="${text}"></arg>)");
+    }
+
+    for (auto level = nesting; level > 0; level -= 1)
+    {
+        emit_line(source, depth + 2 + (level - 1) * 2, "</call>");
+        emit_line(source, depth + 1 + (level - 1) * 2, "</arg>");
+    }
+
+    emit_line(source, depth, "</call>");
+}
+
+static void emit_body(std::string& source, GeneratorOptions const& options, size_t caller)
+{
+    emit_line(source, 2, fmt::format(R"(<let name="text" type="string">{}</let>)", make_literal(options.literalSize, caller)));
+
+    for (auto call = 0zu; call < options.callDensity; call += 1)
+    {
+        emit_call(source, options, caller, call, 2);
+    }
+}
+
+std::string generate_program(GeneratorOptions const& options)
+{
+    std::string source {};
+
+    emit_line(source, 0, "<program>");
+
+    for (auto function = 0zu; function < options.functions; function += 1)
+    {
+        emit_line(source, 1, fmt::format(R"(<function name="f{}" type="string" message="string">)", function));
+        emit_body(source, options, function);
+        emit_line(source, 2, R"(<return value="${message}"></return>)");
+        emit_line(source, 1, "</function>");
+    }
+
+    emit_line(source, 1, R"(<function name="main" type="none">)");
+    emit_body(source, options, options.functions);
+    emit_line(source, 1, "</function>");
+
+    emit_line(source, 0, "</program>");
+
+    return source;
+}
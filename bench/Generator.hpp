@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+struct GeneratorOptions
+{
+    size_t functions {};
+    size_t depth {};
+    size_t literalSize {};
+    size_t callDensity {};
+};
+
+// Builds a program that goes through the whole pipeline without errors: `functions` functions, each making
+// `callDensity` calls whose argument nests `depth` calls to earlier functions, plus a main calling into them.
+std::string generate_program(GeneratorOptions const& options);
@@ -0,0 +1,31 @@
+#include "Pipeline.hpp"
+
+#include "Analyzer.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(Analyzer, AcceptsEveryProgram)
+{
+    for (auto const& path : all_programs())
+    {
+        auto ast = parse_program(path);
+        ASSERT_TRUE(ast.has_value()) << path;
+
+        EXPECT_TRUE(analyze(*ast).has_value()) << path;
+    }
+}
+
+// every one of them passes, declares or returns a value of the wrong type.
+TEST(Analyzer, RejectsValuesOfTheWrongType)
+{
+    auto programs = rejected_programs();
+    ASSERT_FALSE(programs.empty());
+
+    for (auto const& path : programs)
+    {
+        auto ast = parse_program(path);
+        ASSERT_TRUE(ast.has_value()) << path;
+
+        EXPECT_FALSE(analyze(*ast).has_value()) << path;
+    }
+}
@@ -0,0 +1,240 @@
+#include "Bytecode.hpp"
+#include "Instructions.hpp"
+#include "Interpreter.hpp"
+#include "Pipeline.hpp"
+
+#include "Intrinsics.hpp"
+#include "codegen/Assembler.hpp"
+#include "codegen/Superinstructions.hpp"
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <ranges>
+
+static bool contains(std::vector<Decoded> const& code, Opcode opcode, uint8_t mode)
+{
+    return std::ranges::any_of(code, [&] (Decoded const& decoded) { return decoded.opcode == opcode && decoded.mode == mode; });
+}
+
+// arithmetic and ordering on numbers that are only known at run time take the 32 bit integer instructions, equality
+// on strings the one that compares any two values.
+TEST(Assembler, LowersRuntimeArithmeticAndComparisonsToTypedInstructions)
+{
+    auto module = lower_program(test_program("typed_operations.xml"));
+    ASSERT_TRUE(module.has_value()) << module.error().message();
+
+    auto execution = execute(*module);
+    ASSERT_TRUE(execution.has_value()) << execution.error().message();
+    EXPECT_EQ(execution->output, "22 12 85 3 2 -17\nmore\n1 -7 -12 0 -3 3\nat most\nsame\ndifferent\n");
+
+    auto program = assemble(*module);
+    ASSERT_TRUE(program.has_value()) << program.error().message();
+
+    auto bytecode = disassemble(*program);
+    ASSERT_TRUE(bytecode.has_value()) << bytecode.error().message();
+
+    for (auto op : { Arithmetic::ADD, Arithmetic::SUBTRACT, Arithmetic::MULTIPLY, Arithmetic::DIVIDE, Arithmetic::MODULO, Arithmetic::NEGATE })
+    {
+        EXPECT_TRUE(contains(bytecode->code, Opcode::ARITHMETIC, uint8_t(op))) << int(op);
+    }
+
+    EXPECT_TRUE(contains(bytecode->code, Opcode::COMPARE, uint8_t(Comparison::LESS)));
+    EXPECT_TRUE(contains(bytecode->code, Opcode::COMPARE, uint8_t(Comparison::EQUAL)));
+    EXPECT_TRUE(contains(bytecode->code, Opcode::EQUALS, uint8_t(Comparison::EQUAL)));
+    EXPECT_FALSE(contains(bytecode->code, Opcode::EQUALS, uint8_t(Comparison::LESS)));
+
+    auto matched = match_module(*module, *bytecode);
+    EXPECT_TRUE(matched.has_value()) << matched.error().message();
+}
+
+static Bytecode assemble_and_match(Module const& module)
+{
+    auto program = assemble(module);
+    EXPECT_TRUE(program.has_value()) << program.error().message();
+    if (!program.has_value()) return {};
+
+    auto bytecode = disassemble(*program);
+    EXPECT_TRUE(bytecode.has_value()) << bytecode.error().message();
+    if (!bytecode.has_value()) return {};
+
+    auto matched = match_module(module, *bytecode);
+    EXPECT_TRUE(matched.has_value()) << matched.error().message() << "\n" << print_module(module);
+
+    return *bytecode;
+}
+
+TEST(Assembler, RoundTripsEveryProgram)
+{
+    for (auto const& path : all_programs())
+    {
+        SCOPED_TRACE(path.string());
+
+        auto module = lower_program(path);
+        ASSERT_TRUE(module.has_value()) << module.error().message();
+
+        assemble_and_match(*module);
+    }
+}
+
+// a PUSH sign extends its one byte, so it holds -128 to 127, where slots and calls hold 0 to 255.
+TEST(Assembler, EncodesOperandsInOneByteWhenTheyFit)
+{
+    Module module {};
+    module.entrypoint.code = {
+        push(127), { .opcode = Opcode::POP },
+        push(128), { .opcode = Opcode::POP },
+        push(-128), { .opcode = Opcode::POP },
+        push(-129), { .opcode = Opcode::POP },
+        load(255), { .opcode = Opcode::POP },
+        load(256), { .opcode = Opcode::POP },
+        { .opcode = Opcode::RET },
+    };
+
+    auto bytecode = assemble_and_match(module);
+    ASSERT_EQ(bytecode.code.size(), 13zu);
+
+    for (auto [index, size] : { std::pair { 0zu, 2zu }, { 2zu, 5zu }, { 4zu, 2zu }, { 6zu, 5zu }, { 8zu, 2zu }, { 10zu, 5zu } })
+    {
+        EXPECT_EQ(bytecode.code[index + 1].offset - bytecode.code[index].offset, size) << bytecode.code[index].operand;
+    }
+}
+
+// every pair there is, with operands of both widths, and one pair a label comes between.
+TEST(Assembler, FusesEveryPairOfSuperinstructions)
+{
+    Module module {};
+
+    auto hello = intern_constant(module.constants, "hello");
+    auto println = int32_t(*find_intrinsic("println"));
+
+    module.functions.push_back({ .name = "one", .code = { push(1), { .opcode = Opcode::RET } } });
+    module.functions.push_back({ .name = "echo", .parameters = 1, .code = { store(0), load(0), { .opcode = Opcode::RET } } });
+
+    module.entrypoint.labels = 1;
+    module.entrypoint.code = {
+        { .opcode = Opcode::LOAD, .mode = uint8_t(DataSource::DATA_SEGMENT), .operand = hello },
+        { .opcode = Opcode::CALL, .mode = uint8_t(CallMode::INTRINSIC), .operand = println },
+        push(1000), store(300),
+        push(1000), store(3),
+        push(10), store(300),
+        { .opcode = Opcode::CALL, .mode = uint8_t(CallMode::EXTRINSIC), .operand = 0 }, { .opcode = Opcode::POP },
+        { .opcode = Opcode::LOAD, .mode = uint8_t(DataSource::DATA_SEGMENT), .operand = hello },
+        { .opcode = Opcode::CALL, .mode = uint8_t(CallMode::EXTRINSIC), .operand = 1 },
+        { .opcode = Opcode::POP },
+        push(1), { .opcode = Opcode::LABEL, .operand = 0 }, store(0),
+        { .opcode = Opcode::RET },
+    };
+
+    auto bytecode = assemble_and_match(module);
+
+    for (auto index = 0zu; index < SUPERINSTRUCTIONS.size(); index += 1)
+    {
+        EXPECT_TRUE(std::ranges::any_of(bytecode.code, [&] (Decoded const& decoded) { return decoded.superinstruction == index; })) << SUPERINSTRUCTIONS[index].name;
+    }
+
+    // the one opcode and each operand as wide as it has to be.
+    auto pushStore = std::ranges::find(bytecode.code, 1000, &Decoded::operand);
+    ASSERT_NE(pushStore, bytecode.code.end());
+
+    for (auto [size, wide] : { std::pair { 9zu, std::pair { true, true } }, { 6zu, { true, false } }, { 6zu, { false, true } } })
+    {
+        EXPECT_EQ(pushStore[0].wide, wide.first);
+        EXPECT_EQ(pushStore[1].wide, wide.second);
+        EXPECT_EQ(pushStore[2].offset - pushStore[0].offset, size);
+        pushStore += 2;
+    }
+
+    // the jump target has to stay in between the two.
+    EXPECT_FALSE(bytecode.code[bytecode.code.size() - 3].superinstruction.has_value());
+    EXPECT_FALSE(bytecode.code[bytecode.code.size() - 2].superinstruction.has_value());
+}
+
+static Instruction call(int32_t function)
+{
+    return { .opcode = Opcode::CALL, .mode = uint8_t(CallMode::EXTRINSIC), .operand = function };
+}
+
+// a call to a function placed after the caller only learns where it goes once the caller is laid out, and whether it
+// takes 1 byte or 4 depends on everything in between.
+TEST(Assembler, PatchesCallsToLaterFunctions)
+{
+    Module module {};
+
+    module.functions.push_back({ .name = "first", .code = { call(2), { .opcode = Opcode::RET } } });
+    module.functions.push_back({ .name = "large", .code = { push(0) } });
+    module.functions.push_back({ .name = "last", .code = { call(0), { .opcode = Opcode::RET } } });
+
+    // pushes that take 5 bytes each, so that "last" starts well past what a byte holds.
+    for (auto index = 0; index < 100; index += 1)
+    {
+        module.functions[1].code.push_back(push(1000 + index));
+        module.functions[1].code.push_back({ .opcode = Opcode::POP });
+    }
+    module.functions[1].code.push_back({ .opcode = Opcode::RET });
+
+    module.entrypoint.code = { call(0), { .opcode = Opcode::POP }, call(2), { .opcode = Opcode::POP }, push(0), { .opcode = Opcode::RET } };
+
+    auto bytecode = assemble_and_match(module);
+
+    auto calls = bytecode.code | std::views::filter([] (Decoded const& decoded) {
+        return decoded.opcode == Opcode::CALL && decoded.mode == uint8_t(CallMode::EXTRINSIC);
+    });
+    ASSERT_EQ(std::ranges::distance(calls), 4);
+
+    auto first = std::ranges::min(calls, {}, &Decoded::operand).operand;
+    auto last = std::ranges::max(calls, {}, &Decoded::operand).operand;
+    EXPECT_LE(first, int32_t(UINT8_MAX));
+    EXPECT_GT(last, int32_t(UINT8_MAX));
+
+    for (auto const& decoded : calls)
+    {
+        EXPECT_TRUE(decoded.operand == first || decoded.operand == last) << decoded.operand;
+        EXPECT_EQ(decoded.wide, decoded.operand == last) << decoded.operand;
+    }
+}
+
+// past the number of functions that are measured and written on the thread pool, with calls both ways between them.
+TEST(Assembler, LaysOutManyFunctionsInParallel)
+{
+    constexpr auto count = 200;
+
+    Module module {};
+
+    for (auto index = 0; index < count; index += 1)
+    {
+        Function function { .name = fmt::format("f{}", index) };
+
+        if (index + 1 < count) function.code.push_back(call(index + 1));
+        if (index > 0) function.code.push_back(call(index - 1));
+
+        // functions of different sizes, so that where each one starts depends on all of the ones before it.
+        for (auto pair = 0; pair < index % 7; pair += 1)
+        {
+            function.code.push_back(push(1000 * index));
+            function.code.push_back({ .opcode = Opcode::POP });
+        }
+
+        function.code.push_back({ .opcode = Opcode::RET });
+        module.functions.push_back(std::move(function));
+    }
+
+    module.entrypoint.code = { call(0), call(count - 1), push(0), { .opcode = Opcode::RET } };
+
+    auto program = assemble(module);
+    ASSERT_TRUE(program.has_value()) << program.error().message();
+
+    for (auto attempt = 0; attempt < 4; attempt += 1)
+    {
+        auto again = assemble(module);
+        ASSERT_TRUE(again.has_value()) << again.error().message();
+        EXPECT_EQ(*again, *program);
+    }
+
+    // the first few callees are reached with 1 byte, the rest with 4.
+    auto bytecode = assemble_and_match(module);
+    auto calls = bytecode.code | std::views::filter([] (Decoded const& decoded) { return decoded.opcode == Opcode::CALL; });
+    EXPECT_TRUE(std::ranges::any_of(calls, &Decoded::wide));
+    EXPECT_FALSE(std::ranges::all_of(calls, &Decoded::wide));
+}
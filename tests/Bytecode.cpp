@@ -0,0 +1,275 @@
+#include "Bytecode.hpp"
+
+#include "Intrinsics.hpp"
+#include "codegen/Superinstructions.hpp"
+
+#include <liberror/Try.hpp>
+
+#include <algorithm>
+#include <string_view>
+
+using namespace liberror;
+
+static constexpr std::string_view MAGIC = "This is a kubo program";
+static constexpr size_t HEADER_SIZE = MAGIC.size() + 3 * 4;
+
+struct Cursor
+{
+    std::span<uint8_t const> bytes;
+    size_t offset {};
+};
+
+static Result<uint8_t> read_byte(Cursor& cursor)
+{
+    if (cursor.offset >= cursor.bytes.size()) return make_error("bytecode ends in the middle of an instruction at {}", cursor.offset);
+    return cursor.bytes[cursor.offset++];
+}
+
+static Result<int32_t> read_int(Cursor& cursor)
+{
+    auto value = 0u;
+    for (auto index = 0; index < 4; index += 1) value = value << 8 | TRY(read_byte(cursor));
+    return int32_t(value);
+}
+
+// PUSH sign extends its one byte operand, the others are never negative.
+static Result<int32_t> read_operand(Cursor& cursor, Opcode opcode, bool wide)
+{
+    if (wide) return read_int(cursor);
+
+    auto value = TRY(read_byte(cursor));
+
+    return opcode == Opcode::PUSH ? int32_t(int8_t(value)) : int32_t(value);
+}
+
+static Result<void> read_instruction(Cursor& cursor, std::vector<Decoded>& code)
+{
+    auto offset = cursor.offset;
+    auto byte = TRY(read_byte(cursor));
+    auto opcode = size_t(byte >> 3);
+
+    if (opcode >= FIRST_SUPERINSTRUCTION)
+    {
+        if (opcode - FIRST_SUPERINSTRUCTION >= SUPERINSTRUCTIONS.size()) return make_error("unknown superinstruction {:#x} at {}", byte, offset);
+
+        auto index = opcode - FIRST_SUPERINSTRUCTION;
+        auto const& superinstruction = SUPERINSTRUCTIONS[index];
+
+        for (auto part = 0zu; auto const& [partOpcode, partMode] : { superinstruction.first, superinstruction.second })
+        {
+            Decoded decoded { .offset = offset, .opcode = partOpcode, .mode = partMode, .superinstruction = index };
+
+            if (has_variable_operand(partOpcode))
+            {
+                decoded.wide = (byte >> part) & 1;
+                decoded.operand = TRY(read_operand(cursor, partOpcode, decoded.wide));
+            }
+
+            code.push_back(decoded);
+            part += 1;
+        }
+
+        return {};
+    }
+
+    if (opcode >= size_t(Opcode::LABEL)) return make_error("unknown opcode {:#x} at {}", byte, offset);
+
+    Decoded decoded { .offset = offset, .opcode = Opcode(opcode), .mode = uint8_t(byte & 0b111) };
+
+    switch (decoded.opcode)
+    {
+    case Opcode::CALL:
+    case Opcode::LOAD:
+    case Opcode::STORE:
+    case Opcode::ENTER:
+    case Opcode::PUSH: {
+        decoded.wide = byte & 0b100;
+        decoded.mode = uint8_t(byte & 0b11);
+        decoded.operand = TRY(read_operand(cursor, decoded.opcode, decoded.wide));
+        break;
+    }
+    case Opcode::JUMP: decoded.operand = TRY(read_int(cursor)); break;
+    case Opcode::JUMP_TABLE: {
+        decoded.table.low = TRY(read_int(cursor));
+        auto count = TRY(read_int(cursor));
+        decoded.table.fallback = TRY(read_int(cursor));
+
+        if (count < 0 || size_t(count) * 4 > cursor.bytes.size() - cursor.offset) return make_error("jump table at {} runs past the end", offset);
+
+        for (auto label = 0; label < count; label += 1) decoded.table.labels.push_back(TRY(read_int(cursor)));
+        break;
+    }
+    case Opcode::POP:
+    case Opcode::RET: {
+        if (decoded.mode != 0) return make_error("{} at {} has a mode", int(decoded.opcode), offset);
+        break;
+    }
+    case Opcode::COMPARE:
+    case Opcode::EQUALS:
+    case Opcode::ARITHMETIC:
+    case Opcode::LABEL: break;
+    }
+
+    code.push_back(decoded);
+
+    return {};
+}
+
+Result<Bytecode> disassemble(std::span<uint8_t const> program)
+{
+    if (program.size() < HEADER_SIZE || !std::ranges::equal(program.first(MAGIC.size()), MAGIC)) return make_error("bytecode has no kubo header");
+
+    Cursor header { .bytes = program, .offset = MAGIC.size() };
+
+    auto dataStart = TRY(read_int(header));
+    auto codeStart = TRY(read_int(header));
+    auto entrypoint = TRY(read_int(header));
+
+    if (dataStart != 0 || codeStart < 0 || HEADER_SIZE + size_t(codeStart) > program.size()) return make_error("bytecode has segments out of place");
+
+    Bytecode bytecode { .entrypoint = size_t(entrypoint), .size = program.size() - HEADER_SIZE - size_t(codeStart) };
+
+    Cursor data { .bytes = program.subspan(HEADER_SIZE, size_t(codeStart)) };
+
+    while (data.offset < data.bytes.size())
+    {
+        bytecode.offsets.push_back(int32_t(data.offset));
+
+        auto size = TRY(read_int(data));
+        if (size < 0 || size_t(size) > data.bytes.size() - data.offset) return make_error("constant at {} runs past the data segment", data.offset - 4);
+
+        auto text = data.bytes.subspan(data.offset, size_t(size));
+        bytecode.constants.emplace_back(text.begin(), text.end());
+        data.offset += size_t(size);
+    }
+
+    Cursor code { .bytes = program.subspan(HEADER_SIZE + size_t(codeStart)) };
+
+    while (code.offset < code.bytes.size()) TRY(read_instruction(code, bytecode.code));
+
+    return bytecode;
+}
+
+// PUSH sign extends its one byte operand, the others are never negative.
+static bool fits_in_byte(Opcode opcode, int32_t operand)
+{
+    if (opcode == Opcode::PUSH) return operand >= INT8_MIN && operand <= INT8_MAX;
+    return operand >= 0 && operand <= UINT8_MAX;
+}
+
+// which instruction of which function every decoded one came from.
+struct Origin
+{
+    size_t function {};
+    size_t instruction {};
+};
+
+Result<void> match_module(Module const& module, Bytecode const& bytecode)
+{
+    if (bytecode.constants != module.constants.entries) return make_error("the data segment holds other constants than the module");
+    if (bytecode.offsets != module.constants.offsets) return make_error("the constants are at other offsets than the module has them");
+
+    std::vector<Function const*> functions {};
+    for (auto const& function : module.functions) functions.push_back(&function);
+    functions.push_back(&module.entrypoint);
+
+    auto offset_at = [&] (size_t index) { return index < bytecode.code.size() ? bytecode.code[index].offset : bytecode.size; };
+
+    std::vector<size_t> starts(functions.size());
+    std::vector<std::vector<size_t>> labels(functions.size());
+    std::vector<Origin> origins {};
+
+    for (auto index = 0zu; index < functions.size(); index += 1)
+    {
+        auto const& function = *functions[index];
+
+        starts[index] = offset_at(origins.size());
+        labels[index].resize(function.labels);
+
+        // the assembler fuses pairs from the front, so the second of a pair never starts another one.
+        std::vector<std::optional<size_t>> fused(function.code.size());
+
+        for (auto position = 0zu; position + 1 < function.code.size(); position += 1)
+        {
+            if (auto superinstruction = find_superinstruction(function.code[position], function.code[position + 1]))
+            {
+                fused[position] = fused[position + 1] = superinstruction;
+                position += 1;
+            }
+        }
+
+        for (auto position = 0zu; position < function.code.size(); position += 1)
+        {
+            auto const& instruction = function.code[position];
+
+            if (instruction.opcode == Opcode::LABEL)
+            {
+                labels[index].at(size_t(instruction.operand)) = offset_at(origins.size());
+                continue;
+            }
+
+            if (origins.size() >= bytecode.code.size()) return make_error("'{}' is cut short at {}", function.name, position);
+
+            auto const& decoded = bytecode.code[origins.size()];
+
+            if (decoded.opcode != instruction.opcode || decoded.mode != instruction.mode)
+            {
+                return make_error("'{}' has {} at {} where the module has {}", function.name, int(decoded.opcode), decoded.offset, print_instruction(module, function, instruction));
+            }
+
+            if (decoded.superinstruction != fused[position])
+            {
+                return make_error("'{}' encodes {} at {} {} a superinstruction", function.name, print_instruction(module, function, instruction), decoded.offset, fused[position] ? "outside of" : "as part of");
+            }
+
+            origins.push_back({ index, position });
+        }
+    }
+
+    if (origins.size() != bytecode.code.size()) return make_error("the code segment has {} instructions past the last function", bytecode.code.size() - origins.size());
+    if (starts.back() != bytecode.entrypoint) return make_error("the entrypoint is at {}, not at {}", bytecode.entrypoint, starts.back());
+
+    for (auto index = 0zu; index < origins.size(); index += 1)
+    {
+        auto const& decoded = bytecode.code[index];
+        auto const& function = *functions[origins[index].function];
+        auto const& instruction = function.code[origins[index].instruction];
+        auto const& offsets = labels[origins[index].function];
+
+        auto expected = instruction.operand;
+
+        if (instruction.opcode == Opcode::CALL)
+        {
+            expected = is_extrinsic_call(instruction) ? int32_t(starts.at(size_t(instruction.operand))) : int32_t(INTRINSICS.at(size_t(instruction.operand)).id);
+        }
+        else if (instruction.opcode == Opcode::JUMP)
+        {
+            expected = int32_t(offsets.at(size_t(instruction.operand)));
+        }
+        else if (instruction.opcode == Opcode::JUMP_TABLE)
+        {
+            auto table = function.tables.at(size_t(instruction.operand));
+            for (auto& label : table.labels) label = int32_t(offsets.at(size_t(label)));
+            table.fallback = int32_t(offsets.at(size_t(table.fallback)));
+
+            if (decoded.table.low != table.low || decoded.table.labels != table.labels || decoded.table.fallback != table.fallback)
+            {
+                return make_error("'{}' has a jump table at {} that goes elsewhere", function.name, decoded.offset);
+            }
+
+            continue;
+        }
+
+        if (decoded.operand != expected)
+        {
+            return make_error("'{}' has {} at {} where {} was expected for {}", function.name, decoded.operand, decoded.offset, expected, print_instruction(module, function, instruction));
+        }
+
+        if (has_variable_operand(instruction.opcode) && decoded.wide == fits_in_byte(instruction.opcode, expected))
+        {
+            return make_error("'{}' encodes {} at {} in {} byte(s)", function.name, expected, decoded.offset, decoded.wide ? 4 : 1);
+        }
+    }
+
+    return {};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "codegen/IR.hpp"
+
+#include <liberror/Result.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// One instruction read back from the code segment. The two parts of a superinstruction are read as two of these, both
+// at the offset of the one opcode they share.
+struct Decoded
+{
+    // from the start of the code segment.
+    size_t offset {};
+    Opcode opcode {};
+    uint8_t mode {};
+    // a call's target is where the callee starts, or the id of the intrinsic, and a jump's is an offset as well.
+    int32_t operand {};
+    // whether the operand took 4 bytes rather than 1.
+    bool wide {};
+    std::optional<size_t> superinstruction {};
+    // for JUMP_TABLE, with offsets in place of labels.
+    JumpTable table {};
+};
+
+struct Bytecode
+{
+    std::vector<std::string> constants {};
+    // where each constant starts in the data segment.
+    std::vector<int32_t> offsets {};
+    size_t entrypoint {};
+    // how many bytes the code segment takes.
+    size_t size {};
+    std::vector<Decoded> code {};
+};
+
+// Reads a kubo program back the way the VM would, failing on anything it couldn't run.
+liberror::Result<Bytecode> disassemble(std::span<uint8_t const> program);
+
+// Checks that `bytecode` is `module` instruction for instruction: every call reaches where its callee starts, every jump
+// where its label is, pairs of SUPERINSTRUCTIONS are fused and every operand takes 1 byte whenever it fits.
+liberror::Result<void> match_module(Module const& module, Bytecode const& bytecode);
@@ -0,0 +1,78 @@
+#include "Interpreter.hpp"
+#include "Pipeline.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+static bool pushes(Module const& module, int32_t value)
+{
+    auto pushesIn = [&] (Function const& function) {
+        return std::ranges::any_of(function.code, [&] (Instruction const& instruction) {
+            return instruction.opcode == Opcode::PUSH && instruction.operand == value;
+        });
+    };
+
+    return pushesIn(module.entrypoint) || std::ranges::any_of(module.functions, pushesIn);
+}
+
+TEST(Compiler, KeepsStringsMadeOfDigitsInTheDataSegment)
+{
+    auto module = compile_program(test_program("digit_strings.xml"));
+    ASSERT_TRUE(module.has_value()) << module.error().message();
+
+    for (auto const& [text, value] : { std::pair { "123", 123 }, std::pair { "404", 404 } })
+    {
+        EXPECT_TRUE(find_constant(module->constants, text).has_value()) << text;
+        EXPECT_FALSE(pushes(*module, value)) << text;
+    }
+}
+
+// what codegen hands to the passes over the IR only ever jumps forward, wherever it moved blocks to.
+TEST(Compiler, OnlyEverJumpsForward)
+{
+    for (auto const& path : all_programs())
+    {
+        SCOPED_TRACE(path.string());
+
+        auto module = compile_program(path);
+        ASSERT_TRUE(module.has_value()) << module.error().message();
+
+        for (auto const& function : module->functions)
+        {
+            std::vector<bool> placed(function.labels);
+
+            for (auto const& instruction : function.code)
+            {
+                if (instruction.opcode == Opcode::LABEL) placed[size_t(instruction.operand)] = true;
+
+                if (instruction.opcode == Opcode::JUMP)
+                {
+                    EXPECT_FALSE(placed[size_t(instruction.operand)]) << function.name << " jumps back to .L" << instruction.operand;
+                }
+            }
+        }
+    }
+}
+
+// the tail that returns `z` is cold, but it jumps back to the code that returns `u` when it doesn't return.
+TEST(Compiler, KeepsColdBlocksThatJumpOutInPlace)
+{
+    auto module = lower_program(test_program("cold_blocks.xml"));
+    ASSERT_TRUE(module.has_value()) << module.error().message();
+
+    auto execution = execute(*module);
+    ASSERT_TRUE(execution.has_value()) << execution.error().message();
+    EXPECT_EQ(execution->output, "big\n6\n") << print_module(*module);
+}
+
+TEST(Compiler, PrintsTheValuesOfInterpolatedVariables)
+{
+    auto module = lower_program(test_program("interpolation.xml"));
+    ASSERT_TRUE(module.has_value()) << module.error().message();
+
+    auto execution = execute(*module);
+    ASSERT_TRUE(execution.has_value()) << execution.error().message();
+
+    EXPECT_EQ(execution->output, "4world\nhello world, 3 times!\n");
+}
@@ -0,0 +1,28 @@
+#include "Interpreter.hpp"
+#include "Pipeline.hpp"
+
+#include "codegen/Inliner.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+// the entrypoint makes every call at the top of the program, which is inlined the same as any other.
+TEST(Inliner, InlinesIntoTheEntrypoint)
+{
+    auto module = compile_program(test_program("digit_strings.xml"));
+    ASSERT_TRUE(module.has_value()) << module.error().message();
+
+    auto remarks = inline_functions(*module);
+
+    auto main = std::ranges::find_if(remarks, [] (InlineRemark const& remark) { return remark.caller == "entrypoint" && remark.callee == "main"; });
+    ASSERT_NE(main, remarks.end());
+    EXPECT_TRUE(main->inlined) << main->reason;
+
+    EXPECT_FALSE(std::ranges::any_of(module->entrypoint.code, is_extrinsic_call));
+    EXPECT_TRUE(module->functions.empty()) << print_module(*module);
+
+    auto execution = execute(*module);
+    ASSERT_TRUE(execution.has_value()) << execution.error().message();
+    EXPECT_EQ(execution->output, "3\n404\n");
+}
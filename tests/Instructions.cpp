@@ -0,0 +1,23 @@
+#include "Instructions.hpp"
+
+#include "Intrinsics.hpp"
+
+Instruction push(int32_t value)
+{
+    return { .opcode = Opcode::PUSH, .operand = value };
+}
+
+Instruction load(int32_t slot)
+{
+    return { .opcode = Opcode::LOAD, .mode = uint8_t(DataSource::LOCAL_SCOPE), .operand = slot };
+}
+
+Instruction store(int32_t slot)
+{
+    return { .opcode = Opcode::STORE, .mode = uint8_t(DataDestination::LOCAL_SCOPE), .operand = slot };
+}
+
+Instruction println()
+{
+    return { .opcode = Opcode::CALL, .mode = uint8_t(CallMode::INTRINSIC), .operand = int32_t(*find_intrinsic("println")) };
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "codegen/IR.hpp"
+
+#include <cstdint>
+
+// Instructions for the IR the tests build by hand.
+
+Instruction push(int32_t value);
+Instruction load(int32_t slot);
+Instruction store(int32_t slot);
+Instruction println();
@@ -0,0 +1,319 @@
+#include "Interpreter.hpp"
+
+#include "Intrinsics.hpp"
+
+#include <liberror/Try.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <variant>
+
+using namespace liberror;
+
+using Value = std::variant<int32_t, std::string>;
+
+struct Frame
+{
+    Function const* function {};
+    size_t position {};
+    std::vector<std::optional<Value>> slots {};
+    std::vector<Value> stack {};
+};
+
+struct Interpreter
+{
+    Module const& module;
+    std::unordered_map<int32_t, std::string_view> constants {};
+    // where every label of every function is.
+    std::unordered_map<Function const*, std::vector<size_t>> labels {};
+    std::vector<std::optional<Value>> globals {};
+    std::vector<Frame> frames {};
+    Execution execution {};
+};
+
+static void find_labels(Interpreter& interpreter, Function const& function)
+{
+    auto& labels = interpreter.labels[&function];
+    labels.resize(function.labels);
+
+    for (auto position = 0zu; position < function.code.size(); position += 1)
+    {
+        if (function.code[position].opcode == Opcode::LABEL) labels.at(size_t(function.code[position].operand)) = position;
+    }
+}
+
+static std::string text_of(Value const& value)
+{
+    return std::holds_alternative<int32_t>(value) ? std::to_string(std::get<int32_t>(value)) : std::get<std::string>(value);
+}
+
+static bool is_truthy(Value const& value)
+{
+    return std::holds_alternative<int32_t>(value) ? std::get<int32_t>(value) != 0 : !std::get<std::string>(value).empty();
+}
+
+static Result<Value> pop(Frame& frame)
+{
+    if (frame.stack.empty()) return make_error("'{}' pops from an empty stack at {}", frame.function->name, frame.position);
+
+    auto value = std::move(frame.stack.back());
+    frame.stack.pop_back();
+
+    return value;
+}
+
+static Result<int32_t> pop_number(Frame& frame)
+{
+    auto value = TRY(pop(frame));
+
+    if (!std::holds_alternative<int32_t>(value)) return make_error("'{}' expects a number at {}", frame.function->name, frame.position);
+
+    return std::get<int32_t>(value);
+}
+
+static Result<std::string> pop_string(Frame& frame)
+{
+    auto value = TRY(pop(frame));
+
+    if (!std::holds_alternative<std::string>(value)) return make_error("'{}' expects a string at {}", frame.function->name, frame.position);
+
+    return std::get<std::string>(value);
+}
+
+// the arguments are on top of the caller's stack, the last one on top.
+static Result<Frame> enter_function(Interpreter& interpreter, Frame& caller, int32_t index)
+{
+    if (index < 0 || size_t(index) >= interpreter.module.functions.size()) return make_error("call to function {}, which does not exist", index);
+
+    auto const& function = interpreter.module.functions[size_t(index)];
+
+    Frame frame { .function = &function, .slots = std::vector<std::optional<Value>>(function.parameters) };
+
+    for (auto parameter = function.parameters; parameter > 0; parameter -= 1)
+    {
+        frame.slots[parameter - 1] = TRY(pop(caller));
+    }
+
+    return frame;
+}
+
+static Result<void> call_intrinsic(Interpreter& interpreter, Frame& frame, int32_t index)
+{
+    if (index < 0 || size_t(index) >= INTRINSICS.size()) return make_error("call to intrinsic {}, which does not exist", index);
+
+    auto name = INTRINSICS[size_t(index)].name;
+
+    if (name == "print" || name == "println")
+    {
+        interpreter.execution.output += text_of(TRY(pop(frame)));
+        if (name == "println") interpreter.execution.output += '\n';
+    }
+    else if (name == "length")
+    {
+        frame.stack.push_back(int32_t(TRY(pop_string(frame)).size()));
+    }
+    else if (name == "concat")
+    {
+        auto rhs = TRY(pop_string(frame));
+        frame.stack.push_back(TRY(pop_string(frame)) + rhs);
+    }
+    else if (name == "to_string")
+    {
+        frame.stack.push_back(std::to_string(TRY(pop_number(frame))));
+    }
+    else if (name == "hash")
+    {
+        frame.stack.push_back(int32_t(hash_intrinsic(TRY(pop_string(frame)), 0)));
+    }
+    else
+    {
+        return make_error("intrinsic '{}' is not known to the interpreter", name);
+    }
+
+    return {};
+}
+
+static Result<int32_t> arithmetic(Arithmetic op, int32_t lhs, int32_t rhs)
+{
+    // wrapping, like the VM's 32 bit registers.
+    auto wrap = [] (int64_t value) { return int32_t(uint32_t(uint64_t(value))); };
+
+    switch (op)
+    {
+    case Arithmetic::ADD: return wrap(int64_t(lhs) + rhs);
+    case Arithmetic::SUBTRACT: return wrap(int64_t(lhs) - rhs);
+    case Arithmetic::MULTIPLY: return wrap(int64_t(lhs) * rhs);
+    case Arithmetic::DIVIDE: if (rhs == 0) return make_error("division by zero"); return wrap(int64_t(lhs) / rhs);
+    case Arithmetic::MODULO: if (rhs == 0) return make_error("division by zero"); return wrap(int64_t(lhs) % rhs);
+    case Arithmetic::NEGATE: return wrap(-int64_t(lhs));
+    }
+
+    return make_error("unknown arithmetic {}", int(op));
+}
+
+template <class T>
+static bool compare(Comparison comparison, T const& lhs, T const& rhs)
+{
+    switch (comparison)
+    {
+    case Comparison::EQUAL: return lhs == rhs;
+    case Comparison::NOT_EQUAL: return lhs != rhs;
+    case Comparison::LESS: return lhs < rhs;
+    case Comparison::LESS_EQUAL: return lhs <= rhs;
+    case Comparison::GREATER: return lhs > rhs;
+    case Comparison::GREATER_EQUAL: return lhs >= rhs;
+    }
+
+    return false;
+}
+
+static Result<void> jump(Interpreter& interpreter, Frame& frame, int32_t label)
+{
+    auto const& labels = interpreter.labels.at(frame.function);
+
+    if (label < 0 || size_t(label) >= labels.size()) return make_error("'{}' jumps to .L{}, which does not exist", frame.function->name, label);
+
+    frame.position = labels[size_t(label)];
+
+    return {};
+}
+
+// Runs one instruction of the frame on top, returns false once the entrypoint returned.
+static Result<bool> step(Interpreter& interpreter)
+{
+    auto& frame = interpreter.frames.back();
+
+    if (frame.position >= frame.function->code.size()) return make_error("'{}' runs past its end", frame.function->name);
+
+    auto const& instruction = frame.function->code[frame.position];
+    frame.position += 1;
+
+    switch (instruction.opcode)
+    {
+    case Opcode::LABEL: break;
+    case Opcode::ENTER: {
+        if (frame.slots.size() < size_t(instruction.operand)) frame.slots.resize(size_t(instruction.operand));
+        break;
+    }
+    case Opcode::PUSH: frame.stack.push_back(instruction.operand); break;
+    case Opcode::POP: TRY(pop(frame)); break;
+    case Opcode::LOAD: {
+        auto const& slots = DataSource(instruction.mode) == DataSource::GLOBAL_SCOPE ? interpreter.globals : frame.slots;
+
+        if (DataSource(instruction.mode) == DataSource::DATA_SEGMENT)
+        {
+            auto constant = interpreter.constants.find(instruction.operand);
+            if (constant == interpreter.constants.end()) return make_error("'{}' loads .data[{}], which does not exist", frame.function->name, instruction.operand);
+            frame.stack.emplace_back(std::string(constant->second));
+            break;
+        }
+
+        if (size_t(instruction.operand) >= slots.size() || !slots[size_t(instruction.operand)].has_value())
+        {
+            return make_error("'{}' loads slot {} before anything was stored to it", frame.function->name, instruction.operand);
+        }
+
+        frame.stack.push_back(*slots[size_t(instruction.operand)]);
+        break;
+    }
+    case Opcode::STORE: {
+        auto& slots = DataDestination(instruction.mode) == DataDestination::GLOBAL_SCOPE ? interpreter.globals : frame.slots;
+
+        if (size_t(instruction.operand) >= slots.size()) slots.resize(size_t(instruction.operand) + 1);
+        slots[size_t(instruction.operand)] = TRY(pop(frame));
+        break;
+    }
+    case Opcode::COMPARE: {
+        auto rhs = TRY(pop_number(frame));
+        auto lhs = TRY(pop_number(frame));
+        frame.stack.push_back(int32_t(compare(Comparison(instruction.mode), lhs, rhs)));
+        break;
+    }
+    case Opcode::EQUALS: {
+        auto rhs = TRY(pop(frame));
+        auto lhs = TRY(pop(frame));
+        frame.stack.push_back(int32_t(compare(Comparison(instruction.mode), lhs, rhs)));
+        break;
+    }
+    case Opcode::ARITHMETIC: {
+        auto op = Arithmetic(instruction.mode);
+        auto rhs = op == Arithmetic::NEGATE ? 0 : TRY(pop_number(frame));
+        frame.stack.push_back(TRY(arithmetic(op, TRY(pop_number(frame)), rhs)));
+        break;
+    }
+    case Opcode::JUMP: {
+        auto condition = JumpCondition(instruction.mode);
+        if (condition == JumpCondition::ALWAYS || is_truthy(TRY(pop(frame))) == (condition == JumpCondition::IF_TRUE))
+        {
+            TRY(jump(interpreter, frame, instruction.operand));
+        }
+        break;
+    }
+    case Opcode::JUMP_TABLE: {
+        auto const& table = frame.function->tables.at(size_t(instruction.operand));
+        auto index = int64_t(TRY(pop_number(frame))) - table.low;
+        TRY(jump(interpreter, frame, index >= 0 && index < int64_t(table.labels.size()) ? table.labels[size_t(index)] : table.fallback));
+        break;
+    }
+    case Opcode::CALL: {
+        switch (CallMode(instruction.mode))
+        {
+        case CallMode::INTRINSIC: TRY(call_intrinsic(interpreter, frame, instruction.operand)); break;
+        case CallMode::EXTRINSIC: {
+            auto callee = TRY(enter_function(interpreter, frame, instruction.operand));
+            // `frame` is gone once the call stack grows.
+            interpreter.frames.push_back(std::move(callee));
+            break;
+        }
+        case CallMode::TAIL: {
+            auto callee = TRY(enter_function(interpreter, frame, instruction.operand));
+            frame = std::move(callee);
+            break;
+        }
+        }
+        break;
+    }
+    case Opcode::RET: {
+        // a function returns its one value or nothing, and nothing is left over for the entrypoint to return.
+        if (frame.stack.size() > (interpreter.frames.size() > 1 ? 1zu : 0zu))
+        {
+            return make_error("'{}' returns with {} value(s) left on the stack", frame.function->name, frame.stack.size());
+        }
+
+        auto result = frame.stack.empty() ? std::nullopt : std::optional(std::move(frame.stack.back()));
+
+        interpreter.frames.pop_back();
+
+        if (interpreter.frames.empty()) return false;
+        if (result.has_value()) interpreter.frames.back().stack.push_back(std::move(*result));
+        break;
+    }
+    }
+
+    return true;
+}
+
+Result<Execution> execute(Module const& module, size_t maxSteps)
+{
+    Interpreter interpreter { .module = module };
+
+    for (auto entry = 0zu; entry < module.constants.entries.size(); entry += 1)
+    {
+        interpreter.constants.emplace(module.constants.offsets[entry], module.constants.entries[entry]);
+    }
+
+    for (auto const& function : module.functions) find_labels(interpreter, function);
+    find_labels(interpreter, module.entrypoint);
+
+    interpreter.frames.push_back({ .function = &module.entrypoint });
+
+    while (TRY(step(interpreter)))
+    {
+        interpreter.execution.depth = std::max(interpreter.execution.depth, interpreter.frames.size());
+
+        if (++interpreter.execution.steps > maxSteps) return make_error("ran for more than {} steps", maxSteps);
+    }
+
+    return interpreter.execution;
+}
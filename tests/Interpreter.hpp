@@ -0,0 +1,21 @@
+#pragma once
+
+#include "codegen/IR.hpp"
+
+#include <liberror/Result.hpp>
+
+#include <string>
+
+struct Execution
+{
+    // everything print and println wrote.
+    std::string output {};
+    size_t steps {};
+    // the most frames that were ever on the call stack at once.
+    size_t depth {};
+};
+
+// Runs the IR of a module from its entrypoint, the way the VM runs the bytecode it assembles to, so that a pass can be
+// checked to change nothing a program does. Values are 32 bit integers or strings. Reading a slot nothing was stored to,
+// or running for more than `maxSteps`, fails.
+liberror::Result<Execution> execute(Module const& module, size_t maxSteps = 100'000'000);
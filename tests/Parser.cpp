@@ -0,0 +1,115 @@
+#include "Interpreter.hpp"
+#include "Pipeline.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fmt/format.h>
+
+#include <fstream>
+#include <string>
+
+static void collect_returns(std::vector<std::unique_ptr<Node>> const& scope, std::vector<RetStmt const*>& returns)
+{
+    for (auto const& node : scope)
+    {
+        if (node->node_type() != Node::Type::STATEMENT) continue;
+
+        auto statement = static_cast<Statement const*>(node.get());
+
+        if (statement->stmt_type() == Statement::Type::RETURN) returns.push_back(static_cast<RetStmt const*>(statement));
+
+        if (statement->stmt_type() == Statement::Type::IF)
+        {
+            collect_returns(static_cast<IfStmt const*>(statement)->trueBranch, returns);
+            collect_returns(static_cast<IfStmt const*>(statement)->falseBranch, returns);
+        }
+    }
+}
+
+TEST(Parser, TypesAndParsesEveryReturnOfAFunction)
+{
+    auto ast = parse_program(test_program("nested_returns.xml"));
+    ASSERT_TRUE(ast.has_value());
+
+    auto function = static_cast<FunctionDecl const*>(static_cast<ProgramDecl const*>(ast->get())->scope.front().get());
+
+    std::vector<RetStmt const*> returns {};
+    collect_returns(function->scope, returns);
+
+    ASSERT_EQ(returns.size(), 3zu);
+
+    for (auto returnStmt : returns)
+    {
+        EXPECT_EQ(returnStmt->type, "number");
+    }
+
+    // the nested `${x} + 1` and `${x} - 1`, in the order they appear.
+    for (auto returnStmt : { returns[0], returns[1] })
+    {
+        EXPECT_EQ(static_cast<Expression const*>(returnStmt->value.get())->expr_type(), Expression::Type::ARITHMETIC);
+    }
+}
+
+static std::filesystem::path write_program(std::string_view name, std::string_view source)
+{
+    auto path = std::filesystem::temp_directory_path() / fmt::format("xmlc_{}.xml", name);
+    std::ofstream(path) << source;
+    return path;
+}
+
+static std::filesystem::path write_condition(std::string_view name, std::string const& condition)
+{
+    return write_program(name, fmt::format(R"(<program>
+    <function name="main" type="none">
+        <if condition="{}">
+            <call who="println">
+                <arg value="yes"></arg>
+            </call>
+        </if>
+    </function>
+</program>
+)", condition));
+}
+
+// nesting that deep used to be parsed by recursing once per level, until the stack ran out.
+TEST(Parser, RejectsInfixExpressionsNestedTooDeep)
+{
+    static constexpr auto LEVELS = 100'000zu;
+
+    for (auto const& [name, condition] : {
+        std::pair { "parentheses", std::string(LEVELS, '(') + "1" + std::string(LEVELS, ')') },
+        std::pair { "negations", std::string(LEVELS, '!') + "1" },
+        std::pair { "minuses", std::string(LEVELS, '-') + "1" },
+    })
+    {
+        auto path = write_condition(name, condition);
+        EXPECT_FALSE(parse_program(path).has_value()) << name;
+        std::filesystem::remove(path);
+    }
+
+    auto path = write_condition("shallow", std::string(100, '(') + "1" + std::string(100, ')') + " && " + std::string(100, '!') + "0");
+    EXPECT_TRUE(parse_program(path).has_value());
+    std::filesystem::remove(path);
+}
+
+TEST(Parser, AcceptsFunctionsThatReturnFromEveryBranch)
+{
+    auto module = lower_program(test_program("if_else_returns.xml"));
+    ASSERT_TRUE(module.has_value()) << module.error().message();
+
+    auto execution = execute(*module);
+    ASSERT_TRUE(execution.has_value()) << execution.error().message();
+    EXPECT_EQ(execution->output, "-1\n1\n");
+
+    // without the else, a value less than 0 would fall off the end.
+    auto path = write_program("missing_return", R"(<program>
+    <function name="sign" type="number" x="number">
+        <if condition="${x} < 0">
+            <return value="-1"></return>
+        </if>
+    </function>
+</program>
+)");
+    EXPECT_FALSE(parse_program(path).has_value());
+    std::filesystem::remove(path);
+}
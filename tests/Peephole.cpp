@@ -0,0 +1,97 @@
+#include "Instructions.hpp"
+#include "Interpreter.hpp"
+#include "Pipeline.hpp"
+
+#include "codegen/Inliner.hpp"
+#include "codegen/Peephole.hpp"
+#include "codegen/SlotAllocator.hpp"
+#include "codegen/TailCalls.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+static size_t count(Function const& function, Opcode opcode)
+{
+    return size_t(std::ranges::count(function.code, opcode, &Instruction::opcode));
+}
+
+// The IR every program compiles to, as it is right before the peephole pass, is the reference: whatever the pass
+// rewrites has to print the same, and so does what the slot allocator makes of it.
+TEST(Peephole, ChangesNothingAnyProgramPrints)
+{
+    for (auto const& path : all_programs())
+    {
+        SCOPED_TRACE(path.string());
+
+        auto module = compile_program(path);
+        ASSERT_TRUE(module.has_value()) << module.error().message();
+
+        inline_functions(*module);
+        optimize_tail_calls(*module);
+
+        auto original = *module;
+        auto expected = execute(original);
+        ASSERT_TRUE(expected.has_value()) << expected.error().message();
+
+        optimize_peephole(*module);
+
+        auto optimized = execute(*module);
+        ASSERT_TRUE(optimized.has_value()) << optimized.error().message() << '\n' << print_module(*module);
+        EXPECT_EQ(expected->output, optimized->output) << print_module(*module);
+        EXPECT_LE(optimized->steps, expected->steps);
+
+        allocate_slots(*module);
+
+        auto allocated = execute(*module);
+        ASSERT_TRUE(allocated.has_value()) << allocated.error().message() << '\n' << print_module(*module);
+        EXPECT_EQ(expected->output, allocated->output) << print_module(*module);
+    }
+}
+
+TEST(Peephole, KeepsAStoreThatIsLoadedMoreThanOnce)
+{
+    Module module {};
+    module.entrypoint.code = {
+        push(7), store(0), load(0), load(0),
+        { .opcode = Opcode::ARITHMETIC, .mode = uint8_t(Arithmetic::ADD) }, println(), { .opcode = Opcode::RET },
+    };
+
+    optimize_peephole(module);
+
+    EXPECT_EQ(count(module.entrypoint, Opcode::STORE), 1zu);
+    EXPECT_EQ(execute(module).value().output, "14\n");
+}
+
+TEST(Peephole, LeavesTheValueForTheOnlyLoad)
+{
+    Module module {};
+    module.entrypoint.code = { push(7), store(0), load(0), println(), { .opcode = Opcode::RET } };
+
+    optimize_peephole(module);
+
+    EXPECT_EQ(count(module.entrypoint, Opcode::STORE), 0zu);
+    EXPECT_EQ(count(module.entrypoint, Opcode::LOAD), 0zu);
+    EXPECT_EQ(execute(module).value().output, "7\n");
+}
+
+// a conditional jump to the next instruction still pops what it tests, which then cancels out with the push.
+TEST(Peephole, DropsTheTestOfAConditionalJumpToTheNextInstruction)
+{
+    Module module {};
+    module.entrypoint.labels = 1;
+    module.entrypoint.code = {
+        push(3),
+        push(1),
+        { .opcode = Opcode::JUMP, .mode = uint8_t(JumpCondition::IF_TRUE), .operand = 0 },
+        { .opcode = Opcode::LABEL, .operand = 0 },
+        println(),
+        { .opcode = Opcode::RET },
+    };
+
+    optimize_peephole(module);
+
+    EXPECT_EQ(count(module.entrypoint, Opcode::JUMP), 0zu);
+    EXPECT_EQ(count(module.entrypoint, Opcode::PUSH), 1zu);
+    EXPECT_EQ(execute(module).value().output, "3\n");
+}
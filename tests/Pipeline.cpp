@@ -0,0 +1,80 @@
+#include "Pipeline.hpp"
+
+#include "Analyzer.hpp"
+#include "Lexer.hpp"
+#include "Optimizer.hpp"
+#include "codegen/Compiler.hpp"
+#include "codegen/Inliner.hpp"
+#include "codegen/Peephole.hpp"
+#include "codegen/SlotAllocator.hpp"
+#include "codegen/TailCalls.hpp"
+
+#include <liberror/Try.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+using namespace liberror;
+
+std::filesystem::path test_program(std::string_view name)
+{
+    return std::filesystem::path(XMLC_PROGRAMS_DIR) / name;
+}
+
+static std::vector<std::filesystem::path> programs_in(std::filesystem::path const& directory)
+{
+    std::vector<std::filesystem::path> programs {};
+
+    for (auto const& entry : std::filesystem::directory_iterator(directory))
+    {
+        if (entry.path().extension() == ".xml") programs.push_back(entry.path());
+    }
+
+    std::ranges::sort(programs);
+
+    return programs;
+}
+
+std::vector<std::filesystem::path> example_programs()
+{
+    return programs_in(XMLC_EXAMPLES_DIR);
+}
+
+std::vector<std::filesystem::path> all_programs()
+{
+    auto programs = example_programs();
+    std::ranges::copy(programs_in(XMLC_PROGRAMS_DIR), std::back_inserter(programs));
+    return programs;
+}
+
+std::vector<std::filesystem::path> rejected_programs()
+{
+    return programs_in(std::filesystem::path(XMLC_PROGRAMS_DIR) / "rejected");
+}
+
+Result<std::unique_ptr<Node>> parse_program(std::filesystem::path const& path)
+{
+    return parse(tokenize(path));
+}
+
+Result<Module> compile_program(std::filesystem::path const& path)
+{
+    auto ast = TRY(parse_program(path));
+
+    TRY(analyze(ast));
+    TRY(optimize(ast));
+
+    return compile(ast);
+}
+
+Result<Module> lower_program(std::filesystem::path const& path)
+{
+    auto module = TRY(compile_program(path));
+
+    inline_functions(module);
+    optimize_tail_calls(module);
+    optimize_peephole(module);
+    allocate_slots(module);
+
+    return module;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Parser.hpp"
+#include "codegen/IR.hpp"
+
+#include <liberror/Result.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// the regression programs under tests/programs/.
+std::filesystem::path test_program(std::string_view name);
+
+// every program under examples/, in the order they are numbered.
+std::vector<std::filesystem::path> example_programs();
+
+// the examples followed by every regression program.
+std::vector<std::filesystem::path> all_programs();
+
+// the programs under tests/programs/rejected/, which analysis has to reject.
+std::vector<std::filesystem::path> rejected_programs();
+
+liberror::Result<std::unique_ptr<Node>> parse_program(std::filesystem::path const& path);
+
+// parses, analyzes and folds the program, then generates its IR without running any of the passes over it.
+liberror::Result<Module> compile_program(std::filesystem::path const& path);
+
+// compile_program followed by every pass over the IR the compiler runs, in the same order.
+liberror::Result<Module> lower_program(std::filesystem::path const& path);
@@ -0,0 +1,124 @@
+#include "Pipeline.hpp"
+
+#include "Serializer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+// how many corrupted copies of every example are fed back to the deserializer.
+static constexpr size_t MUTATIONS_PER_PROGRAM = 2000;
+
+TEST(Serializer, RoundTripsEveryExample)
+{
+    for (auto const& path : example_programs())
+    {
+        SCOPED_TRACE(path.string());
+
+        auto ast = parse_program(path);
+        ASSERT_TRUE(ast.has_value());
+
+        auto image = serialize_ast(*ast);
+        auto loaded = deserialize_ast(image);
+        ASSERT_TRUE(loaded.has_value()) << loaded.error().message();
+
+        EXPECT_EQ(dump_ast(*ast), dump_ast(*loaded));
+        EXPECT_EQ(image, serialize_ast(*loaded));
+    }
+}
+
+// A cache entry can be cut short or flipped on disk, which must only ever make loading fail. Whatever still loads has to
+// be a tree that survives another round trip unchanged.
+TEST(Serializer, RejectsOrRoundTripsMutatedImages)
+{
+    std::mt19937 random(0x58415354);
+
+    for (auto const& path : example_programs())
+    {
+        SCOPED_TRACE(path.string());
+
+        auto ast = parse_program(path);
+        ASSERT_TRUE(ast.has_value());
+
+        auto const image = serialize_ast(*ast);
+        auto loaded = 0zu;
+
+        for (auto mutation = 0zu; mutation < MUTATIONS_PER_PROGRAM; mutation += 1)
+        {
+            auto mutated = image;
+            auto position = std::uniform_int_distribution<size_t>(0, mutated.size() - 1)(random);
+
+            switch (mutation % 3)
+            {
+            case 0: mutated[position] ^= uint8_t(1u << (random() % 8)); break;
+            case 1: mutated.resize(position); break;
+            case 2: {
+                auto word = position & ~size_t(3);
+                for (auto index = word; index < std::min(word + 4, mutated.size()); index += 1) mutated[index] = uint8_t(random());
+                break;
+            }
+            }
+
+            auto result = deserialize_ast(mutated);
+            if (!result.has_value()) continue;
+
+            loaded += 1;
+
+            auto again = deserialize_ast(serialize_ast(*result));
+            ASSERT_TRUE(again.has_value()) << again.error().message();
+            EXPECT_EQ(dump_ast(*result), dump_ast(*again));
+        }
+
+        // a byte that only holds a token's line or column changes nothing the loader checks, so some always load.
+        EXPECT_GT(loaded, 0zu);
+    }
+}
+
+static void append_u32(std::vector<uint8_t>& image, uint32_t value)
+{
+    for (auto index = 0u; index < 4; index += 1) image.push_back(uint8_t(value >> (8 * index)));
+}
+
+// Every sum adds the one before it to itself, 64 of them fit in about a kilobyte and would expand into 2^64 nodes if
+// the loader followed both sides of each.
+TEST(Serializer, RejectsNodesReachedMoreThanOnce)
+{
+    static constexpr auto SUMS = 64zu;
+
+    std::vector<uint8_t> image { 'X', 'A', 'S', 'T' };
+    append_u32(image, AST_FORMAT_VERSION);
+    append_u32(image, 0);
+    append_u32(image, 0);
+
+    auto text = uint32_t(image.size());
+    append_u32(image, 4);
+    for (auto character : std::string_view("1\0\0\0", 4)) image.push_back(uint8_t(character));
+
+    auto token = uint32_t(image.size());
+    for (auto field : { text, uint32_t(Token::Type {}), text, 0u, 0u, 0u }) append_u32(image, field);
+
+    auto previous = uint32_t(image.size());
+    append_u32(image, uint32_t(Node::Type::EXPRESSION) << 8 | uint32_t(Expression::Type::LITERAL));
+    append_u32(image, token);
+    append_u32(image, text);
+
+    for (auto sum = 0zu; sum < SUMS; sum += 1)
+    {
+        auto offset = uint32_t(image.size());
+        append_u32(image, uint32_t(Node::Type::EXPRESSION) << 8 | uint32_t(Expression::Type::ARITHMETIC));
+        append_u32(image, token);
+        append_u32(image, uint32_t(ArithmeticExpr::Operator::ADD));
+        append_u32(image, previous);
+        append_u32(image, previous);
+        previous = offset;
+    }
+
+    auto size = uint32_t(image.size());
+    for (auto index = 0u; index < 4; index += 1) image[8 + index] = uint8_t(size >> (8 * index));
+    for (auto index = 0u; index < 4; index += 1) image[12 + index] = uint8_t(previous >> (8 * index));
+
+    auto result = deserialize_ast(image);
+    ASSERT_FALSE(result.has_value());
+    EXPECT_NE(result.error().message().find("more than once"), std::string::npos) << result.error().message();
+}
@@ -0,0 +1,49 @@
+#include "Instructions.hpp"
+#include "Interpreter.hpp"
+
+#include "codegen/SlotAllocator.hpp"
+
+#include <gtest/gtest.h>
+
+// Slot 1 is last touched before slot 2 is first stored, but the jump back to .L0 reads it again after that, so the two
+// can't share a slot.
+TEST(SlotAllocator, KeepsSlotsLiveAcrossBackwardJumps)
+{
+    Module module {};
+    module.entrypoint.labels = 1;
+    module.entrypoint.code = {
+        push(5), store(1),
+        push(3), store(0),
+        { .opcode = Opcode::LABEL, .operand = 0 },
+        load(1), println(),
+        load(0), push(1), { .opcode = Opcode::ARITHMETIC, .mode = uint8_t(Arithmetic::SUBTRACT) }, store(0),
+        push(9), store(2), load(2), println(),
+        load(0), { .opcode = Opcode::JUMP, .mode = uint8_t(JumpCondition::IF_TRUE), .operand = 0 },
+        { .opcode = Opcode::RET },
+    };
+
+    auto expected = execute(module);
+    ASSERT_TRUE(expected.has_value()) << expected.error().message();
+    ASSERT_EQ(expected->output, "5\n9\n5\n9\n5\n9\n");
+
+    auto stats = allocate_slots(module);
+
+    EXPECT_EQ(stats.slotsAfter, 3zu);
+    EXPECT_EQ(execute(module).value().output, expected->output) << print_module(module);
+}
+
+// Slot 1 is dead by the time slot 2 is stored on every path, so they share one.
+TEST(SlotAllocator, PacksSlotsWhoseLifetimesDontOverlap)
+{
+    Module module {};
+    module.entrypoint.code = {
+        push(5), store(1), load(1), println(),
+        push(9), store(2), load(2), println(),
+        { .opcode = Opcode::RET },
+    };
+
+    auto stats = allocate_slots(module);
+
+    EXPECT_EQ(stats.slotsAfter, 1zu);
+    EXPECT_EQ(execute(module).value().output, "5\n9\n");
+}
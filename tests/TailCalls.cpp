@@ -0,0 +1,52 @@
+#include "Interpreter.hpp"
+#include "Pipeline.hpp"
+
+#include "codegen/TailCalls.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <span>
+
+TEST(TailCalls, TurnsSelfRecursionIntoStoresAndAJumpToTheEntry)
+{
+    auto module = compile_program(test_program("tail_calls.xml"));
+    ASSERT_TRUE(module.has_value()) << module.error().message();
+
+    auto stats = optimize_tail_calls(*module);
+    EXPECT_EQ(stats.selfCalls, 1zu);
+
+    auto const& count = module->functions.front();
+    auto const& code = count.code;
+
+    ASSERT_GE(code.size(), 4zu);
+    ASSERT_EQ(code.front().opcode, Opcode::LABEL);
+
+    // the arguments go over the parameters, the last one first, and then it starts over.
+    auto tail = std::span(code).last(3);
+    EXPECT_EQ(tail[0].opcode, Opcode::STORE);
+    EXPECT_EQ(tail[0].operand, 1);
+    EXPECT_EQ(tail[1].opcode, Opcode::STORE);
+    EXPECT_EQ(tail[1].operand, 0);
+    EXPECT_EQ(tail[2].opcode, Opcode::JUMP);
+    EXPECT_EQ(JumpCondition(tail[2].mode), JumpCondition::ALWAYS);
+    EXPECT_EQ(tail[2].operand, code.front().operand);
+
+    EXPECT_FALSE(std::ranges::any_of(code, [] (Instruction const& instruction) { return instruction.opcode == Opcode::CALL; }));
+    // only the base case returns.
+    EXPECT_EQ(std::ranges::count(code, Opcode::RET, &Instruction::opcode), 1);
+}
+
+// a million calls deep would need a million frames, it runs in the one `count` started with instead.
+TEST(TailCalls, RecursesAMillionTimesInConstantStack)
+{
+    auto module = lower_program(test_program("tail_calls.xml"));
+    ASSERT_TRUE(module.has_value()) << module.error().message();
+
+    auto execution = execute(*module);
+    ASSERT_TRUE(execution.has_value()) << execution.error().message();
+
+    EXPECT_EQ(execution->output, "1000000\n");
+    // the entrypoint, which main is inlined into, and count.
+    EXPECT_EQ(execution->depth, 2zu);
+}
@@ -0,0 +1,257 @@
+#include "Analyzer.hpp"
+#include "Lexer.hpp"
+#include "Optimizer.hpp"
+#include "Parser.hpp"
+#include "codegen/Compiler.hpp"
+#include "codegen/Inliner.hpp"
+#include "codegen/Peephole.hpp"
+#include "codegen/SlotAllocator.hpp"
+#include "codegen/Superinstructions.hpp"
+#include "codegen/TailCalls.hpp"
+
+#include <argparse/argparse.hpp>
+#include <fmt/format.h>
+#include <liberror/Result.hpp>
+#include <liberror/Try.hpp>
+#include <magic_enum/magic_enum.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace liberror;
+
+// every instruction of an n-gram takes 16 bits of its key.
+static constexpr size_t MAX_NGRAM_LENGTH = 4;
+
+struct Mining
+{
+    size_t length {};
+    size_t instructions {};
+    // how many pairs the superinstructions the assembler knows already fuse.
+    size_t fused {};
+    std::unordered_map<uint64_t, size_t> counts {};
+};
+
+// what the VM dispatches on, the opcode and its mode. the operands don't matter, a superinstruction takes any.
+static uint16_t shape_of(Instruction const& instruction)
+{
+    return uint16_t(uint16_t(instruction.opcode) << 8 | instruction.mode);
+}
+
+static std::string shape_name(uint16_t shape)
+{
+    auto opcode = Opcode(shape >> 8);
+    auto mode = uint8_t(shape & 0xFF);
+
+    auto name = std::string(magic_enum::enum_name(opcode));
+
+    switch (opcode)
+    {
+    case Opcode::CALL: return fmt::format("{} {}", name, magic_enum::enum_name(CallMode(mode)));
+    case Opcode::LOAD: return fmt::format("{} {}", name, magic_enum::enum_name(DataSource(mode)));
+    case Opcode::STORE: return fmt::format("{} {}", name, magic_enum::enum_name(DataDestination(mode)));
+    case Opcode::JUMP: return fmt::format("{} {}", name, magic_enum::enum_name(JumpCondition(mode)));
+    case Opcode::COMPARE:
+    case Opcode::EQUALS: return fmt::format("{} {}", name, magic_enum::enum_name(Comparison(mode)));
+    case Opcode::ARITHMETIC: return fmt::format("{} {}", name, magic_enum::enum_name(Arithmetic(mode)));
+    case Opcode::POP:
+    case Opcode::PUSH:
+    case Opcode::RET:
+    case Opcode::ENTER:
+    case Opcode::JUMP_TABLE:
+    case Opcode::LABEL: break;
+    }
+
+    return name;
+}
+
+// the shapes of an n-gram are packed first to last, each one plus one so that a key also tells how long it is.
+static std::vector<uint16_t> unpack_ngram(uint64_t key)
+{
+    std::vector<uint16_t> shapes {};
+
+    for (; key != 0; key >>= 16) shapes.push_back(uint16_t((key & 0xFFFF) - 1));
+
+    std::ranges::reverse(shapes);
+
+    return shapes;
+}
+
+static void mine_function(Mining& mining, Function const& function)
+{
+    auto const& code = function.code;
+
+    for (auto start = 0zu; start < code.size(); start += 1)
+    {
+        if (code[start].opcode == Opcode::LABEL) continue;
+
+        mining.instructions += 1;
+
+        // a label in between means something jumps into the middle, so nothing can be fused across it.
+        for (auto key = uint64_t(0), end = start; end < code.size() && end - start < mining.length; end += 1)
+        {
+            if (code[end].opcode == Opcode::LABEL) break;
+
+            key = key << 16 | uint64_t(shape_of(code[end]) + 1);
+
+            if (end > start) mining.counts[key] += 1;
+        }
+    }
+
+    // the same greedy left to right matching the assembler does.
+    for (auto index = 0zu; index + 1 < code.size(); index += 1)
+    {
+        if (find_superinstruction(code[index], code[index + 1]))
+        {
+            mining.fused += 1;
+            index += 1;
+        }
+    }
+}
+
+// the same pipeline the compiler runs, up to where the assembler would take over.
+static Result<Module> compile_file(std::filesystem::path const& path)
+{
+    auto ast = TRY(parse(tokenize(path)));
+
+    TRY(analyze(ast));
+    TRY(optimize(ast));
+
+    auto module = TRY(compile(ast));
+    inline_functions(module);
+    optimize_tail_calls(module);
+    optimize_peephole(module);
+    allocate_slots(module);
+
+    return module;
+}
+
+static std::string_view find_fused(std::vector<uint16_t> const& shapes)
+{
+    if (shapes.size() != 2) return {};
+
+    auto matches = [] (SuperinstructionPart part, uint16_t shape) {
+        return shape == uint16_t(uint16_t(part.opcode) << 8 | part.mode);
+    };
+
+    for (auto const& superinstruction : SUPERINSTRUCTIONS)
+    {
+        if (matches(superinstruction.first, shapes[0]) && matches(superinstruction.second, shapes[1])) return superinstruction.name;
+    }
+
+    return {};
+}
+
+static void report(Mining const& mining, size_t files, size_t top)
+{
+    // fusing n instructions into one saves n - 1 dispatches every time the sequence shows up.
+    auto saved = [] (std::pair<uint64_t, size_t> const& ngram) {
+        return ngram.second * (unpack_ngram(ngram.first).size() - 1);
+    };
+
+    auto percent = [&] (size_t dispatches) {
+        return mining.instructions ? 100.0 * double(dispatches) / double(mining.instructions) : 0.0;
+    };
+
+    std::vector<std::pair<uint64_t, size_t>> ngrams(mining.counts.begin(), mining.counts.end());
+
+    std::ranges::sort(ngrams, [&] (auto const& lhs, auto const& rhs) {
+        return saved(lhs) != saved(rhs) ? saved(lhs) > saved(rhs) : lhs.first < rhs.first;
+    });
+
+    fmt::print("{} instruction(s) over {} file(s)\n", mining.instructions, files);
+    fmt::print("the current superinstructions save {} dispatch(es), {:.1f}%\n\n", mining.fused, percent(mining.fused));
+    fmt::print("{:>8} {:>8} {:>7}  sequence\n", "count", "saved", "");
+
+    for (auto const& ngram : std::span(ngrams).first(std::min(top, ngrams.size())))
+    {
+        auto shapes = unpack_ngram(ngram.first);
+
+        std::string sequence {};
+
+        for (auto shape : shapes)
+        {
+            if (!sequence.empty()) sequence += " -> ";
+            sequence += shape_name(shape);
+        }
+
+        auto fused = find_fused(shapes);
+
+        fmt::print("{:>8} {:>8} {:>6.1f}%  {}{}\n", ngram.second, saved(ngram), percent(saved(ngram)), sequence,
+            fused.empty() ? "" : fmt::format(" ({})", fused));
+    }
+}
+
+Result<void> safe_main(std::span<char const*> arguments)
+{
+    argparse::ArgumentParser cli("xmlc_ngrams", "", argparse::default_arguments::help);
+    cli.add_description("counts the instruction sequences a corpus of programs compiles to, to pick superinstructions from. "
+                        "the savings assume every instruction runs equally often, and overlapping sequences are counted "
+                        "more than once, so they are an upper bound.");
+
+    cli.add_argument("files").help("the programs to compile").nargs(argparse::nargs_pattern::at_least_one);
+    cli.add_argument("-n", "--length").help("the longest sequence to count").default_value(3zu).scan<'u', size_t>();
+    cli.add_argument("-t", "--top").help("how many sequences to report").default_value(20zu).scan<'u', size_t>();
+
+    try
+    {
+        cli.parse_args(static_cast<int>(arguments.size()), arguments.data());
+    }
+    catch (std::exception const& exception)
+    {
+        return liberror::make_error(exception.what());
+    }
+
+    auto length = cli.get<size_t>("--length");
+
+    if (length < 2 || length > MAX_NGRAM_LENGTH)
+    {
+        return make_error("the length must be between 2 and {}", MAX_NGRAM_LENGTH);
+    }
+
+    Mining mining { .length = length };
+
+    auto files = 0zu;
+
+    for (auto const& file : cli.get<std::vector<std::string>>("files"))
+    {
+        if (!std::filesystem::exists(file))
+        {
+            return make_error("source {} does not exist.", file);
+        }
+
+        auto module = compile_file(file);
+
+        // one broken program shouldn't throw away everything mined from the rest of the corpus.
+        if (!module.has_value())
+        {
+            fmt::print(stderr, "skipping {}: {}\n", file, module.error().message());
+            continue;
+        }
+
+        for (auto const& function : module->functions) mine_function(mining, function);
+        mine_function(mining, module->entrypoint);
+
+        files += 1;
+    }
+
+    report(mining, files, cli.get<size_t>("--top"));
+
+    return {};
+}
+
+int main(int argc, char const** argv)
+{
+    auto result = safe_main(std::span<char const*>(argv, size_t(argc)));
+
+    if (!result.has_value())
+    {
+        std::cout << result.error().message() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
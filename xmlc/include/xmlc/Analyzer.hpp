@@ -0,0 +1,7 @@
+#pragma once
+
+#include "Parser.hpp"
+
+#include <liberror/Result.hpp>
+
+liberror::Result<void> analyze(std::unique_ptr<Node> const& ast);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Parser.hpp"
+
+#include <filesystem>
+#include <memory>
+
+// Entries are keyed by the source path, its content and the compiler version,
+// so an entry only ever matches the exact input it was produced from.
+std::filesystem::path ast_cache_entry(std::filesystem::path const& source);
+
+std::unique_ptr<Node> load_cached_ast(std::filesystem::path const& entry);
+void store_cached_ast(std::filesystem::path const& entry, std::unique_ptr<Node> const& ast);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Lexer.hpp"
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+enum class Severity { ERROR, WARNING };
+
+using Issue = std::pair<Token, std::string_view>;
+
+void emit_diagnostic(Severity severity, std::string_view title, std::vector<Issue> const& issues);
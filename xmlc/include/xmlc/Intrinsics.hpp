@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+inline constexpr size_t MAX_INTRINSIC_PARAMETERS = 2;
+
+// Everything the compiler knows about a function the VM implements natively.
+struct Intrinsic
+{
+    std::string_view name;
+    // what the VM knows it by and what a call to it encodes, so it must never change once a VM ships with it.
+    uint8_t id;
+    // "any" accepts a value of any type.
+    std::array<std::string_view, MAX_INTRINSIC_PARAMETERS> parameters;
+    size_t arity;
+    // the type it returns.
+    std::string_view type;
+    // a pure intrinsic only computes its result, so a call whose result goes unused can be dropped.
+    bool pure;
+};
+
+// The IR refers to an intrinsic by its index in here, adding one is just another entry.
+inline constexpr std::array INTRINSICS {
+    Intrinsic { .name = "print", .id = 0, .parameters = { "any" }, .arity = 1, .type = "none", .pure = false },
+    Intrinsic { .name = "println", .id = 1, .parameters = { "any" }, .arity = 1, .type = "none", .pure = false },
+    Intrinsic { .name = "length", .id = 2, .parameters = { "string" }, .arity = 1, .type = "number", .pure = true },
+    Intrinsic { .name = "concat", .id = 3, .parameters = { "string", "string" }, .arity = 2, .type = "string", .pure = true },
+    Intrinsic { .name = "to_string", .id = 4, .parameters = { "number" }, .arity = 1, .type = "string", .pure = true },
+    Intrinsic { .name = "hash", .id = 5, .parameters = { "string" }, .arity = 1, .type = "number", .pure = true },
+};
+
+consteval bool has_unique_intrinsic_ids()
+{
+    for (size_t lhs = 0; lhs < INTRINSICS.size(); lhs += 1)
+    {
+        for (size_t rhs = lhs + 1; rhs < INTRINSICS.size(); rhs += 1)
+        {
+            if (INTRINSICS[lhs].id == INTRINSICS[rhs].id) return false;
+        }
+    }
+
+    return true;
+}
+
+static_assert(has_unique_intrinsic_ids(), "every intrinsic needs an id of its own");
+
+// A perfect hash over the names above, found at compile time: every name lands in a bucket of its own, so a lookup is
+// one hash, one bucket and one comparison, however many intrinsics there are.
+struct IntrinsicTable
+{
+    static constexpr size_t SIZE = std::bit_ceil(INTRINSICS.size() * 2);
+
+    uint32_t seed {};
+    // an index into INTRINSICS plus one, with 0 marking the bucket as empty.
+    std::array<uint16_t, SIZE> buckets {};
+};
+
+constexpr uint32_t hash_intrinsic(std::string_view name, uint32_t seed)
+{
+    // FNV-1a, starting from the seed instead of the usual offset basis.
+    auto hash = 2166136261u ^ seed;
+
+    for (auto character : name)
+    {
+        hash ^= uint8_t(character);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+consteval IntrinsicTable make_intrinsic_table()
+{
+    for (uint32_t seed = 0; ; seed += 1)
+    {
+        IntrinsicTable table { .seed = seed };
+
+        auto collides = false;
+
+        for (size_t index = 0; index < INTRINSICS.size() && !collides; index += 1)
+        {
+            auto& bucket = table.buckets[hash_intrinsic(INTRINSICS[index].name, seed) & (IntrinsicTable::SIZE - 1)];
+            collides = bucket != 0;
+            bucket = uint16_t(index + 1);
+        }
+
+        if (!collides) return table;
+    }
+}
+
+inline constexpr IntrinsicTable INTRINSIC_TABLE = make_intrinsic_table();
+
+constexpr std::optional<size_t> find_intrinsic(std::string_view name)
+{
+    auto bucket = INTRINSIC_TABLE.buckets[hash_intrinsic(name, INTRINSIC_TABLE.seed) & (IntrinsicTable::SIZE - 1)];
+
+    if (bucket == 0 || INTRINSICS[bucket - 1].name != name) return std::nullopt;
+
+    return bucket - 1zu;
+}
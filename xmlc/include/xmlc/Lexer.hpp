@@ -38,10 +38,10 @@ struct Token
         END_OF_FILE
     };
 
-    std::string data;
-    Type type;
-    Location location;
-    size_t depth;
+    std::string data {};
+    Type type {};
+    Location location {};
+    size_t depth {};
 };
 
 std::vector<Token> tokenize(std::filesystem::path const& path);
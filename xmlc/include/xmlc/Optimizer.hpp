@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Parser.hpp"
+
+#include <liberror/Result.hpp>
+
+struct OptimizationStats
+{
+    size_t removedFunctions {};
+    size_t removedStatements {};
+};
+
+// Runs on an analyzed tree, right before codegen. Expressions whose operands are all known are folded into literals,
+// `let`s of such values are propagated into their uses, and `if`s with a known condition are replaced by the branch
+// that is taken. Then functions the entrypoint never reaches, and lets nothing reads, are removed.
+liberror::Result<OptimizationStats> optimize(std::unique_ptr<Node> const& ast);
@@ -4,8 +4,8 @@
 
 #include <liberror/Result.hpp>
 
-#include <vector>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #define NODE_TYPE(TYPE)                                                  \
@@ -14,7 +14,7 @@ constexpr virtual Node::Type node_type() const override { return TYPE; } \
 struct Node
 {
     // cppcheck-suppress [unknownMacro]
-    enum class Type { DECLARATION, EXPRESSION, STATEMENT };
+    enum class Type { DECLARATION, EXPRESSION, STATEMENT, ERROR };
 
     virtual ~Node() = default;
 
@@ -23,6 +23,12 @@ struct Node
     Token token;
 };
 
+// Stands in for a construct that failed to parse, so that the rest of the tree survives the error.
+struct ErrorNode : public Node
+{
+    NODE_TYPE(Node::Type::ERROR);
+};
+
 struct Declaration : public Node
 {
     NODE_TYPE(Node::Type::DECLARATION);
@@ -71,18 +77,46 @@ struct Expression : public Node
     constexpr virtual Type expr_type() const = 0;
 };
 
+// Conditions and comparisons, which evaluate to 1 when they hold and to 0 otherwise.
 struct LogicalExpr : public Expression
 {
     EXPR_TYPE(Expression::Type::LOGICAL)
 
-    std::unique_ptr<Node> value;
+    enum class Operator { AND, OR, NOT, EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+
+    Operator op {};
+    std::unique_ptr<Node> lhs {};
+    // left empty for NOT.
+    std::unique_ptr<Node> rhs {};
+
+    // filled in by analyze() when both operands are numbers, so comparing them never has to look at what type they are.
+    bool numeric {};
 };
 
 struct ArithmeticExpr : public Expression
 {
     EXPR_TYPE(Expression::Type::ARITHMETIC)
 
-    std::unique_ptr<Node> value;
+    enum class Operator { ADD, SUBTRACT, MULTIPLY, DIVIDE, MODULO, NEGATE };
+
+    Operator op {};
+    std::unique_ptr<Node> lhs {};
+    // left empty for NEGATE.
+    std::unique_ptr<Node> rhs {};
+};
+
+// A run of a literal's value, either plain text or the name inside a `${name}` interpolation.
+struct Segment
+{
+    enum class Kind { TEXT, VARIABLE };
+
+    Kind kind {};
+    size_t offset {};
+    size_t size {};
+
+    // filled in by analyze() for a variable, whose value is loaded and, when it is a number, turned into a string.
+    std::optional<size_t> slot {};
+    bool numeric {};
 };
 
 struct LiteralExpr : public Expression
@@ -90,14 +124,35 @@ struct LiteralExpr : public Expression
     EXPR_TYPE(Expression::Type::LITERAL)
 
     std::string value;
+
+    // left empty when the value has no interpolations at all, which is by far the common case.
+    std::vector<Segment> segments {};
+
+    // filled in by analyze() when the literal names a variable
+    std::optional<size_t> slot {};
 };
 
+struct Callee
+{
+    // cppcheck-suppress [unknownMacro]
+    enum class Kind { UNRESOLVED, INTRINSIC, FUNCTION };
+
+    Kind kind {};
+    size_t index {};
+};
+
+// A call in statement position is the same node with its result discarded.
 struct CallExpr : public Expression
 {
     EXPR_TYPE(Expression::Type::CALL)
 
     std::vector<std::unique_ptr<Node>> arguments {};
     std::string who {};
+    bool discarded {};
+
+    // filled in by analyze()
+    Callee callee {};
+    std::string type {};
 };
 
 struct ArgExpr : public Expression
@@ -117,7 +172,6 @@ struct Statement : public Node
     // cppcheck-suppress [unknownMacro]
     enum class Type
     {
-        CALL,
         IF,
         LET,
         RETURN,
@@ -126,14 +180,6 @@ struct Statement : public Node
     constexpr virtual Type stmt_type() const = 0;
 };
 
-struct CallStmt : public Statement
-{
-    STMT_TYPE(Statement::Type::CALL);
-
-    std::vector<std::unique_ptr<Node>> arguments {};
-    std::string who {};
-};
-
 struct RetStmt : public Statement
 {
     STMT_TYPE(Statement::Type::RETURN);
@@ -149,6 +195,9 @@ struct LetStmt : public Statement
     std::string name;
     std::string type;
     std::unique_ptr<Node> value {};
+
+    // filled in by analyze()
+    size_t slot {};
 };
 
 struct IfStmt : public Statement
@@ -160,5 +209,15 @@ struct IfStmt : public Statement
     std::vector<std::unique_ptr<Node>> falseBranch {};
 };
 
+std::vector<Segment> split_interpolations(std::string_view value);
+
+struct PartialAst
+{
+    std::unique_ptr<Node> ast;
+    size_t errors;
+};
+
+// Always yields a program, with every construct that failed to parse replaced by an ErrorNode.
+PartialAst parse_partial(std::vector<Token> const& tokens);
 liberror::Result<std::unique_ptr<Node>> parse(std::vector<Token> const& tokens);
 nlohmann::ordered_json dump_ast(std::unique_ptr<Node> const& node);
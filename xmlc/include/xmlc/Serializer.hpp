@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Parser.hpp"
+
+#include <liberror/Result.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Bump whenever the on-disk layout or the meaning of any node field changes.
+inline constexpr uint32_t AST_FORMAT_VERSION = 6;
+
+// The image is a flat little-endian buffer of 4-byte aligned records:
+//
+//   header   : "XAST" version size root
+//   string   : length bytes... (padded to 4)
+//   list     : count offset...
+//   token    : data type file line column depth
+//   node     : node_type kind token fields...
+//
+// Every reference is an offset relative to the start of the image, so it can
+// be mapped or copied anywhere as is. Records are written children first,
+// which means a node only ever references lower offsets, and every node and
+// list is referenced exactly once.
+std::vector<uint8_t> serialize_ast(std::unique_ptr<Node> const& ast);
+liberror::Result<std::unique_ptr<Node>> deserialize_ast(std::span<uint8_t const> image);
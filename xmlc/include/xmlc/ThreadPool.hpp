@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of workers, each with its own queue. Workers take from the back of their own queue and, once it runs dry,
+// steal from the front of the others, so uneven jobs even out without a single shared queue to fight over.
+struct ThreadPool
+{
+    struct Queue
+    {
+        std::mutex mutex {};
+        std::deque<std::function<void()>> jobs {};
+    };
+
+    explicit ThreadPool(size_t workers);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    std::vector<std::unique_ptr<Queue>> queues {};
+    std::vector<std::thread> workers {};
+
+    std::mutex mutex {};
+    std::condition_variable wakeup {};
+    // jobs sitting in any of the queues.
+    size_t pending {};
+    // where the next batch starts handing out its chunks, so batches don't all pile onto the first queue.
+    size_t next {};
+    bool stopping {};
+};
+
+// Runs `job(index)` for every index below `count` and returns once all of them are done. The calling thread takes part in
+// the work too, which keeps calls from inside a job, or from many threads at once, from ever starving.
+void parallel_for(ThreadPool& pool, size_t count, std::function<void(size_t)> const& job);
+
+// Shared by every compilation in the process. It is sized by XMLC_JOBS when set, or by the number of hardware threads.
+ThreadPool& shared_thread_pool();
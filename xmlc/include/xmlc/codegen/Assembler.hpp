@@ -1,7 +1,9 @@
 #pragma once
 
+#include "codegen/IR.hpp"
+
 #include <liberror/Result.hpp>
 
 #include <vector>
 
-liberror::Result<std::vector<uint8_t>> assemble(std::string const& code);
+liberror::Result<std::vector<uint8_t>> assemble(Module const& module);
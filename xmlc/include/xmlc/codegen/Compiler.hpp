@@ -1,9 +1,8 @@
 #pragma once
 
 #include "Parser.hpp"
+#include "codegen/IR.hpp"
 
 #include <liberror/Result.hpp>
 
-#include <string>
-
-liberror::Result<std::string> compile(std::unique_ptr<Node> const& ast);
+liberror::Result<Module> compile(std::unique_ptr<Node> const& ast);
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The numeric values are part of the bytecode, every instruction starts with `opcode << 3` and keeps its mode in the low
+// bits. CALL, LOAD, STORE, PUSH and ENTER take a 1 byte operand whenever it fits, and 4 bytes otherwise. Pairs listed
+// in SUPERINSTRUCTIONS are encoded as one instruction. LABEL only marks a jump target and is never encoded.
+enum class Opcode
+{
+    CALL,
+    LOAD,
+    POP,
+    PUSH,
+    RET,
+    STORE,
+    ENTER,
+    COMPARE,
+    JUMP,
+    JUMP_TABLE,
+    ARITHMETIC,
+    EQUALS,
+    LABEL
+};
+
+// a TAIL call hands the current frame over to the callee, which returns straight to the caller's caller.
+enum class CallMode { EXTRINSIC, INTRINSIC, TAIL };
+
+// pops the right hand side and then the left one, and pushes 1 when the comparison holds or 0 otherwise. COMPARE only
+// ever sees 32 bit integers, EQUALS takes values of any type and only EQUAL or NOT_EQUAL.
+enum class Comparison { EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+// on 32 bit integers, which is what every `number` is. pops the right hand side and then the left one, or only the one
+// operand for NEGATE, and pushes the result.
+enum class Arithmetic { ADD, SUBTRACT, MULTIPLY, DIVIDE, MODULO, NEGATE };
+// the conditional ones pop the value they test.
+enum class JumpCondition { ALWAYS, IF_TRUE, IF_FALSE };
+
+enum class DataSource { DATA_SEGMENT, LOCAL_SCOPE, GLOBAL_SCOPE };
+enum class DataDestination { LOCAL_SCOPE, GLOBAL_SCOPE };
+
+struct Instruction
+{
+    Opcode opcode {};
+    // CallMode for CALL, DataSource for LOAD, DataDestination for STORE, Comparison for COMPARE and EQUALS, JumpCondition
+    // for JUMP and Arithmetic for ARITHMETIC.
+    uint8_t mode {};
+    // the callee index for CALL, the offset or slot for LOAD and STORE, the value for PUSH, the number of scope slots
+    // for ENTER, the label for JUMP and LABEL, and the index of the function's table for JUMP_TABLE.
+    int32_t operand {};
+};
+
+// Pops a value and jumps to `labels[value - low]`, or to `fallback` when that is out of range.
+struct JumpTable
+{
+    int32_t low {};
+    std::vector<int32_t> labels {};
+    int32_t fallback {};
+};
+
+bool is_extrinsic_call(Instruction const& instruction);
+bool is_local_load(Instruction const& instruction);
+bool is_local_store(Instruction const& instruction);
+
+struct Function
+{
+    std::string name {};
+    // the arguments are on the stack when the function starts, and end up in the first scope slots.
+    size_t parameters {};
+    std::vector<Instruction> code {};
+    std::vector<JumpTable> tables {};
+    // labels are numbered from 0 within each function, this is how many were handed out.
+    size_t labels {};
+};
+
+int32_t make_label(Function& function);
+
+// The strings of the data segment, interned by content so that every distinct one is stored once, at an offset that
+// never changes once handed out.
+struct ConstantPool
+{
+    std::vector<std::string> entries {};
+    std::vector<size_t> hashes {};
+    std::vector<int32_t> offsets {};
+
+    // open addressing with linear probing, a bucket holds an index into `entries` plus one, with 0 marking it empty.
+    std::vector<uint32_t> buckets {};
+
+    // every entry is encoded as its 4 byte length followed by its contents, this is the total once encoded.
+    int32_t size {};
+
+    size_t references {};
+    size_t savedBytes {};
+};
+
+int32_t intern_constant(ConstantPool& pool, std::string_view value);
+std::optional<int32_t> find_constant(ConstantPool const& pool, std::string_view value);
+
+struct Module
+{
+    ConstantPool constants {};
+
+    // extrinsic calls refer to a function by its index in here.
+    std::vector<Function> functions {};
+    Function entrypoint {};
+};
+
+std::string print_instruction(Module const& module, Function const& function, Instruction const& instruction);
+std::string print_module(Module const& module);
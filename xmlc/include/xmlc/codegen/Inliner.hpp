@@ -0,0 +1,19 @@
+#pragma once
+
+#include "codegen/IR.hpp"
+
+#include <string>
+#include <vector>
+
+struct InlineRemark
+{
+    std::string caller {};
+    std::string callee {};
+    bool inlined {};
+    // why the call was or wasn't inlined.
+    std::string reason {};
+};
+
+// Replaces calls to small, non-recursive functions with a copy of their body, then drops the functions nothing calls
+// anymore. Returns one remark for every call that was considered.
+std::vector<InlineRemark> inline_functions(Module& module);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "codegen/IR.hpp"
+
+#include <string_view>
+#include <vector>
+
+struct PeepholeHits
+{
+    std::string_view rule {};
+    size_t count {};
+};
+
+// Rewrites short runs of instructions that do nothing observable into shorter ones, until no rule applies anymore.
+// Returns how many times each rule fired, in the order the rules are tried.
+std::vector<PeepholeHits> optimize_peephole(Module& module);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "codegen/IR.hpp"
+
+struct SlotStats
+{
+    // summed over every function.
+    size_t slotsBefore {};
+    size_t slotsAfter {};
+};
+
+// Renumbers the scope slots of every function so that variables whose lifetimes don't overlap share a slot, then starts
+// each function with an ENTER of how many slots it ended up with, for the VM to size its frame up front. This has to be
+// the last pass over the IR.
+SlotStats allocate_slots(Module& module);
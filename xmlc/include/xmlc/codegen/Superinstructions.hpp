@@ -0,0 +1,113 @@
+#pragma once
+
+#include "codegen/IR.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+struct SuperinstructionPart
+{
+    Opcode opcode;
+    uint8_t mode;
+};
+
+// Two instructions that follow each other often enough for the VM to run them as one. Each part keeps its own operand,
+// 1 byte wide or 4 bytes wide, just as it would on its own.
+struct Superinstruction
+{
+    std::string_view name;
+    SuperinstructionPart first;
+    SuperinstructionPart second;
+};
+
+// superinstructions are encoded as the opcodes from here on, in the order they appear below. the low bits tell which
+// operands are wide, 1 for the first part's and 2 for the second's.
+inline constexpr uint8_t FIRST_SUPERINSTRUCTION = 16;
+
+// The first three are what traces of the VM spend the most dispatches on, the others are what xmlc_ngrams finds most
+// over the examples. The VM decodes these by their position, so new ones may only ever be appended.
+inline constexpr std::array SUPERINSTRUCTIONS {
+    Superinstruction {
+        .name = "load_call",
+        .first = { Opcode::LOAD, uint8_t(DataSource::DATA_SEGMENT) },
+        .second = { Opcode::CALL, uint8_t(CallMode::INTRINSIC) },
+    },
+    Superinstruction {
+        .name = "push_store",
+        .first = { Opcode::PUSH, 0 },
+        .second = { Opcode::STORE, uint8_t(DataDestination::LOCAL_SCOPE) },
+    },
+    Superinstruction {
+        .name = "call_pop",
+        .first = { Opcode::CALL, uint8_t(CallMode::EXTRINSIC) },
+        .second = { Opcode::POP, 0 },
+    },
+    Superinstruction {
+        .name = "load_call_function",
+        .first = { Opcode::LOAD, uint8_t(DataSource::DATA_SEGMENT) },
+        .second = { Opcode::CALL, uint8_t(CallMode::EXTRINSIC) },
+    },
+    Superinstruction {
+        .name = "load_ret",
+        .first = { Opcode::LOAD, uint8_t(DataSource::LOCAL_SCOPE) },
+        .second = { Opcode::RET, 0 },
+    },
+};
+
+// whether the instruction carries an operand of 1 or 4 bytes.
+constexpr bool has_variable_operand(Opcode opcode)
+{
+    switch (opcode)
+    {
+    case Opcode::CALL:
+    case Opcode::LOAD:
+    case Opcode::STORE:
+    case Opcode::ENTER:
+    case Opcode::PUSH: return true;
+    case Opcode::POP:
+    case Opcode::RET:
+    case Opcode::COMPARE:
+    case Opcode::EQUALS:
+    case Opcode::ARITHMETIC:
+    case Opcode::JUMP:
+    case Opcode::JUMP_TABLE:
+    case Opcode::LABEL: return false;
+    }
+
+    return false;
+}
+
+consteval bool are_superinstructions_encodable()
+{
+    if (FIRST_SUPERINSTRUCTION <= uint8_t(Opcode::LABEL) || FIRST_SUPERINSTRUCTION + SUPERINSTRUCTIONS.size() > 32) return false;
+
+    // jumps take labels and tables, which the fused forms have no room for.
+    auto fusable = [] (SuperinstructionPart part) {
+        return part.opcode != Opcode::JUMP && part.opcode != Opcode::JUMP_TABLE && part.opcode != Opcode::LABEL;
+    };
+
+    for (auto const& superinstruction : SUPERINSTRUCTIONS)
+    {
+        if (!fusable(superinstruction.first) || !fusable(superinstruction.second)) return false;
+    }
+
+    return true;
+}
+
+static_assert(are_superinstructions_encodable(), "superinstructions must fit in the opcode bits and never contain a jump");
+
+constexpr std::optional<size_t> find_superinstruction(Instruction const& first, Instruction const& second)
+{
+    auto matches = [] (SuperinstructionPart part, Instruction const& instruction) {
+        return part.opcode == instruction.opcode && part.mode == instruction.mode;
+    };
+
+    for (auto index = 0zu; index < SUPERINSTRUCTIONS.size(); index += 1)
+    {
+        if (matches(SUPERINSTRUCTIONS[index].first, first) && matches(SUPERINSTRUCTIONS[index].second, second)) return index;
+    }
+
+    return std::nullopt;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "codegen/IR.hpp"
+
+struct TailCallStats
+{
+    size_t selfCalls {};
+    size_t otherCalls {};
+};
+
+// A call whose result is returned right away doesn't need the caller's frame anymore. Calls back into the same function
+// become a jump to its start, with the arguments stored over the parameters, and every other one becomes a TAIL call
+// that reuses the frame. Either way, recursion through them runs in constant stack.
+TailCallStats optimize_tail_calls(Module& module);
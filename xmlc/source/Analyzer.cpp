@@ -0,0 +1,470 @@
+#include "Analyzer.hpp"
+#include "Diagnostic.hpp"
+#include "Intrinsics.hpp"
+
+#include <fmt/format.h>
+#include <liberror/Try.hpp>
+
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+using namespace liberror;
+
+enum class AnalyzerError
+{
+    UNDECLARED_VARIABLE,
+    UNDECLARED_FUNCTION,
+    REDECLARED_VARIABLE,
+    REDECLARED_FUNCTION,
+    ARGUMENT_COUNT_MISMATCH,
+    ARGUMENT_TYPE_MISMATCH,
+    VALUE_TYPE_MISMATCH,
+    NONE_VALUE_USED,
+    NUMBER_EXPECTED,
+};
+
+struct Variable
+{
+    size_t slot;
+    std::string_view type;
+};
+
+struct Scope
+{
+    std::unordered_map<std::string_view, Variable> variables {};
+    std::vector<std::string_view> declared {};
+    size_t slots {};
+};
+
+struct Analysis
+{
+    std::unordered_map<std::string_view, std::pair<size_t, FunctionDecl const*>> functions {};
+    Scope scope {};
+    size_t errors {};
+};
+
+static void emit_analyzer_error(Analysis& analysis, AnalyzerError const& error, std::vector<Issue> const& issues)
+{
+    analysis.errors += 1;
+
+    switch (error)
+    {
+    case AnalyzerError::UNDECLARED_VARIABLE: { emit_diagnostic(Severity::ERROR, "undeclared variable", issues); break; }
+    case AnalyzerError::UNDECLARED_FUNCTION: { emit_diagnostic(Severity::ERROR, "undeclared function", issues); break; }
+    case AnalyzerError::REDECLARED_VARIABLE: { emit_diagnostic(Severity::ERROR, "redeclared variable", issues); break; }
+    case AnalyzerError::REDECLARED_FUNCTION: { emit_diagnostic(Severity::ERROR, "redeclared function", issues); break; }
+    case AnalyzerError::ARGUMENT_COUNT_MISMATCH: { emit_diagnostic(Severity::ERROR, "argument count mismatch", issues); break; }
+    case AnalyzerError::ARGUMENT_TYPE_MISMATCH: { emit_diagnostic(Severity::ERROR, "argument type mismatch", issues); break; }
+    case AnalyzerError::VALUE_TYPE_MISMATCH: { emit_diagnostic(Severity::ERROR, "value type mismatch", issues); break; }
+    case AnalyzerError::NONE_VALUE_USED: { emit_diagnostic(Severity::ERROR, "value of type none used", issues); break; }
+    case AnalyzerError::NUMBER_EXPECTED: { emit_diagnostic(Severity::ERROR, "number expected", issues); break; }
+    }
+}
+
+static bool is_number(std::string_view value)
+{
+    if (value.starts_with('-')) value.remove_prefix(1);
+    return !value.empty() && std::ranges::all_of(value, ::isdigit);
+}
+
+// a literal names a variable only when it is exactly one "${name}".
+static std::optional<std::string_view> variable_name(LiteralExpr const* expression)
+{
+    auto const& segments = expression->segments;
+
+    if (!(segments.size() == 1 && segments.front().kind == Segment::Kind::VARIABLE)) return std::nullopt;
+
+    return std::string_view(expression->value).substr(segments.front().offset, segments.front().size);
+}
+
+static size_t declare_variable(Analysis& analysis, Token const& token, std::string_view name, std::string_view type)
+{
+    auto slot = analysis.scope.slots++;
+
+    if (!analysis.scope.variables.insert({ name, { slot, type } }).second)
+    {
+        emit_analyzer_error(analysis, AnalyzerError::REDECLARED_VARIABLE, {{ token, "is already declared in this scope" }});
+        return slot;
+    }
+
+    analysis.scope.declared.push_back(name);
+
+    return slot;
+}
+
+static void leave_block(Analysis& analysis, size_t mark)
+{
+    while (analysis.scope.declared.size() > mark)
+    {
+        analysis.scope.variables.erase(analysis.scope.declared.back());
+        analysis.scope.declared.pop_back();
+    }
+}
+
+static void analyze_node(Analysis& analysis, Node* node);
+
+static void analyze_nodes(Analysis& analysis, std::vector<std::unique_ptr<Node>> const& nodes)
+{
+    for (auto const& node : nodes)
+    {
+        analyze_node(analysis, node.get());
+    }
+}
+
+static void analyze_literal_expression(Analysis& analysis, LiteralExpr* expression)
+{
+    if (auto name = variable_name(expression))
+    {
+        auto variable = analysis.scope.variables.find(*name);
+
+        if (variable == analysis.scope.variables.end())
+        {
+            emit_analyzer_error(analysis, AnalyzerError::UNDECLARED_VARIABLE, {{ expression->token, "was not declared in this scope" }});
+            return;
+        }
+
+        expression->slot = variable->second.slot;
+
+        return;
+    }
+
+    for (auto& segment : expression->segments)
+    {
+        if (segment.kind != Segment::Kind::VARIABLE) continue;
+
+        auto name = std::string_view(expression->value).substr(segment.offset, segment.size);
+        auto variable = analysis.scope.variables.find(name);
+
+        if (variable == analysis.scope.variables.end())
+        {
+            emit_analyzer_error(analysis, AnalyzerError::UNDECLARED_VARIABLE, {{ expression->token, "interpolates a variable that was not declared in this scope" }});
+            continue;
+        }
+
+        segment.slot = variable->second.slot;
+        segment.numeric = variable->second.type == "number";
+    }
+}
+
+// arithmetic and ordering only make sense on numbers, equality and the logical operators take anything.
+static void expect_number_operand(Analysis& analysis, Node const* operand)
+{
+    if (!operand || operand->node_type() != Node::Type::EXPRESSION) return;
+    if (static_cast<Expression const*>(operand)->expr_type() != Expression::Type::LITERAL) return;
+
+    auto literal = static_cast<LiteralExpr const*>(operand);
+
+    if (auto name = variable_name(literal))
+    {
+        auto variable = analysis.scope.variables.find(*name);
+
+        if (variable != analysis.scope.variables.end() && variable->second.type != "number")
+        {
+            emit_analyzer_error(analysis, AnalyzerError::NUMBER_EXPECTED, {{ literal->token, fmt::format("uses '{}', which is a {}, as a number", *name, variable->second.type) }});
+        }
+    }
+}
+
+// the type an operand evaluates to, every arithmetic and logical expression results in a number.
+static std::string_view operand_type(Analysis const& analysis, Node const* operand)
+{
+    if (!operand || operand->node_type() != Node::Type::EXPRESSION) return {};
+
+    auto expression = static_cast<Expression const*>(operand);
+
+    switch (expression->expr_type())
+    {
+    case Expression::Type::ARG: return operand_type(analysis, static_cast<ArgExpr const*>(expression)->value.get());
+    case Expression::Type::ARITHMETIC:
+    case Expression::Type::LOGICAL: return "number";
+    case Expression::Type::CALL: return static_cast<CallExpr const*>(expression)->type;
+    case Expression::Type::LITERAL: {
+        auto literal = static_cast<LiteralExpr const*>(expression);
+
+        if (auto name = variable_name(literal))
+        {
+            auto variable = analysis.scope.variables.find(*name);
+            return variable == analysis.scope.variables.end() ? std::string_view {} : variable->second.type;
+        }
+
+        return is_number(literal->value) ? "number" : "string";
+    }
+    }
+
+    return {};
+}
+
+// the type of `value` when it isn't `type`, or nothing when it is. "any" takes a value of any type, and a value of type none
+// or of an unknown type was already reported where it was used.
+static std::string_view mismatched_type(Analysis const& analysis, Node const* value, std::string_view type)
+{
+    auto actual = operand_type(analysis, value);
+
+    if (type == "any" || actual.empty() || actual == "none" || actual == type) return {};
+
+    return actual;
+}
+
+static void expect_argument_type(Analysis& analysis, CallExpr const* expression, size_t index, std::string_view type)
+{
+    auto argument = static_cast<ArgExpr const*>(expression->arguments[index].get());
+    auto actual = mismatched_type(analysis, argument->value.get(), type);
+
+    if (actual.empty()) return;
+
+    auto message = fmt::format("passes a {} as argument {}, which expects a {}", actual, index + 1, type);
+    emit_analyzer_error(analysis, AnalyzerError::ARGUMENT_TYPE_MISMATCH, {{ argument->token, message }});
+}
+
+static void analyze_arithmetic_expression(Analysis& analysis, ArithmeticExpr* expression)
+{
+    analyze_node(analysis, expression->lhs.get());
+    analyze_node(analysis, expression->rhs.get());
+
+    expect_number_operand(analysis, expression->lhs.get());
+    expect_number_operand(analysis, expression->rhs.get());
+}
+
+static void analyze_logical_expression(Analysis& analysis, LogicalExpr* expression)
+{
+    analyze_node(analysis, expression->lhs.get());
+    analyze_node(analysis, expression->rhs.get());
+
+    switch (expression->op)
+    {
+    case LogicalExpr::Operator::LESS:
+    case LogicalExpr::Operator::LESS_EQUAL:
+    case LogicalExpr::Operator::GREATER:
+    case LogicalExpr::Operator::GREATER_EQUAL: {
+        expect_number_operand(analysis, expression->lhs.get());
+        expect_number_operand(analysis, expression->rhs.get());
+        expression->numeric = true;
+        break;
+    }
+    case LogicalExpr::Operator::EQUAL:
+    case LogicalExpr::Operator::NOT_EQUAL: {
+        expression->numeric = operand_type(analysis, expression->lhs.get()) == "number" && operand_type(analysis, expression->rhs.get()) == "number";
+        break;
+    }
+    case LogicalExpr::Operator::AND:
+    case LogicalExpr::Operator::OR:
+    case LogicalExpr::Operator::NOT: break;
+    }
+}
+
+static void analyze_call_expression(Analysis& analysis, CallExpr* expression)
+{
+    analyze_nodes(analysis, expression->arguments);
+
+    if (auto maybeIntrinsic = find_intrinsic(expression->who))
+    {
+        auto const& intrinsic = INTRINSICS[*maybeIntrinsic];
+
+        expression->callee = { Callee::Kind::INTRINSIC, *maybeIntrinsic };
+        expression->type = intrinsic.type;
+
+        if (expression->arguments.size() != intrinsic.arity)
+        {
+            auto message = fmt::format("expects {} argument(s), but {} were given", intrinsic.arity, expression->arguments.size());
+            emit_analyzer_error(analysis, AnalyzerError::ARGUMENT_COUNT_MISMATCH, {{ expression->token, message }});
+            return;
+        }
+
+        for (auto index = 0zu; index < intrinsic.arity; index += 1)
+        {
+            expect_argument_type(analysis, expression, index, intrinsic.parameters[index]);
+        }
+    }
+    else if (auto maybeFunction = analysis.functions.find(expression->who); maybeFunction != analysis.functions.end())
+    {
+        auto [index, function] = maybeFunction->second;
+
+        expression->callee = { Callee::Kind::FUNCTION, index };
+        expression->type = function->type;
+
+        if (expression->arguments.size() != function->parameters.size())
+        {
+            auto message = fmt::format("expects {} argument(s), but {} were given", function->parameters.size(), expression->arguments.size());
+            emit_analyzer_error(analysis, AnalyzerError::ARGUMENT_COUNT_MISMATCH, {{ expression->token, message }});
+        }
+        else
+        {
+            for (auto argument = 0zu; argument < function->parameters.size(); argument += 1)
+            {
+                expect_argument_type(analysis, expression, argument, function->parameters[argument].second);
+            }
+        }
+    }
+    else
+    {
+        emit_analyzer_error(analysis, AnalyzerError::UNDECLARED_FUNCTION, {{ expression->token, "calls a function that was never declared" }});
+        return;
+    }
+
+    if (!expression->discarded && expression->type == "none")
+    {
+        emit_analyzer_error(analysis, AnalyzerError::NONE_VALUE_USED, {{ expression->token, "returns none, yet its result is used" }});
+    }
+}
+
+// a let or a return of a string keeps a literal made of digits as the text it is, so only a variable or a call can be a number there.
+static std::string_view mismatched_value_type(Analysis const& analysis, Node const* value, std::string_view type)
+{
+    auto literal = value && value->node_type() == Node::Type::EXPRESSION && static_cast<Expression const*>(value)->expr_type() == Expression::Type::LITERAL;
+
+    if (type == "string" && literal && !variable_name(static_cast<LiteralExpr const*>(value))) return {};
+
+    return mismatched_type(analysis, value, type);
+}
+
+static void analyze_let_statement(Analysis& analysis, LetStmt* statement)
+{
+    analyze_node(analysis, statement->value.get());
+
+    if (auto actual = mismatched_value_type(analysis, statement->value.get(), statement->type); !actual.empty())
+    {
+        auto message = fmt::format("declares a {}, yet its value is a {}", statement->type, actual);
+        emit_analyzer_error(analysis, AnalyzerError::VALUE_TYPE_MISMATCH, {{ statement->token, message }});
+    }
+
+    statement->slot = declare_variable(analysis, statement->token, statement->name, statement->type);
+}
+
+static void analyze_return_statement(Analysis& analysis, RetStmt* statement)
+{
+    analyze_node(analysis, statement->value.get());
+
+    if (!statement->value) return;
+
+    if (auto actual = mismatched_value_type(analysis, statement->value.get(), statement->type); !actual.empty())
+    {
+        auto message = fmt::format("returns a {} from a function of type {}", actual, statement->type);
+        emit_analyzer_error(analysis, AnalyzerError::VALUE_TYPE_MISMATCH, {{ statement->token, message }});
+    }
+}
+
+static void analyze_if_statement(Analysis& analysis, IfStmt* statement)
+{
+    analyze_node(analysis, statement->condition.get());
+
+    for (auto const* branch : { &statement->trueBranch, &statement->falseBranch })
+    {
+        auto mark = analysis.scope.declared.size();
+        analyze_nodes(analysis, *branch);
+        leave_block(analysis, mark);
+    }
+}
+
+static void analyze_function_declaration(Analysis& analysis, FunctionDecl* declaration)
+{
+    analysis.scope = {};
+
+    for (auto const& [name, type] : declaration->parameters)
+    {
+        declare_variable(analysis, declaration->token, name, type);
+    }
+
+    analyze_nodes(analysis, declaration->scope);
+}
+
+static void analyze_program_declaration(Analysis& analysis, ProgramDecl* declaration)
+{
+    for (auto index = 0zu; auto const& child : declaration->scope)
+    {
+        if (!(child->node_type() == Node::Type::DECLARATION && static_cast<Declaration const*>(child.get())->decl_type() == Declaration::Type::FUNCTION))
+        {
+            continue;
+        }
+
+        auto function = static_cast<FunctionDecl const*>(child.get());
+
+        if (auto [previous, inserted] = analysis.functions.insert({ function->name, { index++, function } }); !inserted)
+        {
+            emit_analyzer_error(analysis, AnalyzerError::REDECLARED_FUNCTION, { { previous->second.second->token, "was first declared here" }, { function->token, "and declared again here" } });
+        }
+    }
+
+    for (auto const& child : declaration->scope)
+    {
+        if (child->node_type() == Node::Type::DECLARATION)
+        {
+            analyze_node(analysis, child.get());
+        }
+    }
+
+    analysis.scope = {};
+
+    for (auto const& child : declaration->scope)
+    {
+        if (child->node_type() != Node::Type::DECLARATION)
+        {
+            analyze_node(analysis, child.get());
+        }
+    }
+}
+
+static void analyze_node(Analysis& analysis, Node* node)
+{
+    if (!node) return;
+
+    switch (node->node_type())
+    {
+    case Node::Type::DECLARATION: {
+        auto declaration = static_cast<Declaration*>(node);
+
+        switch (declaration->decl_type())
+        {
+        case Declaration::Type::PROGRAM: return analyze_program_declaration(analysis, static_cast<ProgramDecl*>(declaration));
+        case Declaration::Type::FUNCTION: return analyze_function_declaration(analysis, static_cast<FunctionDecl*>(declaration));
+        }
+
+        break;
+    }
+    case Node::Type::EXPRESSION: {
+        auto expression = static_cast<Expression*>(node);
+
+        switch (expression->expr_type())
+        {
+        case Expression::Type::ARG: return analyze_node(analysis, static_cast<ArgExpr*>(expression)->value.get());
+        case Expression::Type::ARITHMETIC: return analyze_arithmetic_expression(analysis, static_cast<ArithmeticExpr*>(expression));
+        case Expression::Type::LOGICAL: return analyze_logical_expression(analysis, static_cast<LogicalExpr*>(expression));
+        case Expression::Type::CALL: return analyze_call_expression(analysis, static_cast<CallExpr*>(expression));
+        case Expression::Type::LITERAL: return analyze_literal_expression(analysis, static_cast<LiteralExpr*>(expression));
+        }
+
+        break;
+    }
+    case Node::Type::STATEMENT: {
+        auto statement = static_cast<Statement*>(node);
+
+        switch (statement->stmt_type())
+        {
+        case Statement::Type::IF: return analyze_if_statement(analysis, static_cast<IfStmt*>(statement));
+        case Statement::Type::LET: return analyze_let_statement(analysis, static_cast<LetStmt*>(statement));
+        case Statement::Type::RETURN: return analyze_return_statement(analysis, static_cast<RetStmt*>(statement));
+        }
+
+        break;
+    }
+    case Node::Type::ERROR: {
+        // the parser already reported it, this only keeps a partial tree from reaching codegen.
+        analysis.errors += 1;
+        break;
+    }
+    }
+}
+
+Result<void> analyze(std::unique_ptr<Node> const& ast)
+{
+    Analysis analysis {};
+
+    analyze_node(analysis, ast.get());
+
+    if (analysis.errors)
+    {
+        return make_error("analysis failed with {} error(s)", analysis.errors);
+    }
+
+    return {};
+}
@@ -0,0 +1,86 @@
+#include "Cache.hpp"
+#include "Serializer.hpp"
+
+#include <fmt/format.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#ifndef XMLC_VERSION
+#define XMLC_VERSION "unknown"
+#endif
+
+static uint64_t fnv1a(uint64_t hash, std::string_view data)
+{
+    for (auto byte : data)
+    {
+        hash ^= static_cast<uint8_t>(byte);
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+static std::filesystem::path cache_directory()
+{
+    if (auto directory = std::getenv("XMLC_CACHE_DIR")) return directory;
+    if (auto directory = std::getenv("XDG_CACHE_HOME")) return std::filesystem::path(directory) / "xmlc";
+    if (auto directory = std::getenv("HOME")) return std::filesystem::path(directory) / ".cache" / "xmlc";
+
+    return std::filesystem::temp_directory_path() / "xmlc";
+}
+
+std::filesystem::path ast_cache_entry(std::filesystem::path const& source)
+{
+    std::ifstream stream(source, std::ios::binary);
+    std::string content { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+
+    std::error_code error;
+    auto path = std::filesystem::weakly_canonical(source, error);
+
+    uint64_t hash = 0xcbf29ce484222325;
+    hash = fnv1a(hash, XMLC_VERSION);
+    hash = fnv1a(hash, fmt::format("{}", AST_FORMAT_VERSION));
+    hash = fnv1a(hash, error ? source.string() : path.string());
+    hash = fnv1a(hash, content);
+
+    return cache_directory() / fmt::format("{:016x}.xast", hash);
+}
+
+std::unique_ptr<Node> load_cached_ast(std::filesystem::path const& entry)
+{
+    std::ifstream stream(entry, std::ios::binary);
+    if (!stream) return nullptr;
+
+    std::vector<uint8_t> image { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+
+    auto ast = deserialize_ast(image);
+    if (!ast.has_value()) return nullptr;
+
+    return std::move(ast.value());
+}
+
+void store_cached_ast(std::filesystem::path const& entry, std::unique_ptr<Node> const& ast)
+{
+    std::error_code error;
+
+    std::filesystem::create_directories(entry.parent_path(), error);
+    if (error) return;
+
+    auto image = serialize_ast(ast);
+
+    // written aside and renamed into place, so that concurrent compilations never observe a partial entry.
+    auto partial = entry;
+    partial += fmt::format(".{:08x}", std::random_device{}());
+
+    std::ofstream stream(partial, std::ios::binary);
+    stream.write(reinterpret_cast<char const*>(image.data()), static_cast<std::streamsize>(image.size()));
+    stream.close();
+
+    if (stream) std::filesystem::rename(partial, entry, error);
+    if (!stream || error) std::filesystem::remove(partial, error);
+}
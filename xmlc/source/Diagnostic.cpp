@@ -0,0 +1,73 @@
+#include "Diagnostic.hpp"
+
+#include <libcoro/Generator.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace libcoro;
+
+auto static constexpr RED = "\033[31m";
+auto static constexpr GREEN = "\033[32m";
+auto static constexpr BLUE = "\033[34m";
+auto static constexpr YELLOW = "\033[33m";
+auto static constexpr RESET = "\033[00m";
+
+static Generator<std::string> next_line(std::filesystem::path const& path)
+{
+    std::ifstream stream(path);
+
+    for (std::string line; std::getline(stream, line); )
+    {
+        co_yield line;
+    }
+
+    co_return;
+}
+
+void emit_diagnostic(Severity severity, std::string_view title, std::vector<Issue> const& issues)
+{
+    std::vector<std::string> lines {};
+
+    for (auto const& line : next_line(issues.at(0).first.location.first))
+    {
+        // cppcheck-suppress [useStlAlgorithm]
+        lines.push_back(line);
+    }
+
+    auto color = severity == Severity::ERROR ? RED : YELLOW;
+
+    std::cout << color << (severity == Severity::ERROR ? "[error]: " : "[warning]: ") << RESET << title << '\n';
+
+    for (auto const& [token, message] : issues)
+    {
+        auto& [data, type, location, depth] = token;
+        auto& [file, position] = location;
+        auto& [line, column] = position;
+
+        auto beforeToken = lines.at(line).substr(0, 1+column-data.size());
+        auto afterToken  = column ? lines.at(line).substr(1+column) : "";
+
+        std::cout << '\n';
+        std::cout << "at " << file.string() << ':' << line+1 << ':' << beforeToken.size() + 1<< '\n';
+        std::cout << '\n';
+
+        auto index = beforeToken.find_first_not_of(' ');
+
+        if (index != std::string::npos)
+        {
+            beforeToken = beforeToken.substr(index);
+        }
+        else if (std::all_of(beforeToken.begin(), beforeToken.end(), ::isspace))
+        {
+            beforeToken = "";
+        }
+
+        std::cout << GREEN << std::right << std::setw(4) << line+1 << RESET << " | " << beforeToken << BLUE << token.data << RESET << afterToken << '\n';
+        std::cout << "    " << " | " << std::string(beforeToken.size(), ' ') << color << std::string(data.size(), '^') << RESET << ' ' << message << '\n';
+    }
+
+    if (severity == Severity::ERROR) std::cout << '\n';
+}
@@ -18,6 +18,8 @@ using namespace std::literals;
 static Generator<Token> next_token(std::string_view line)
 {
     auto depth = 0zu;
+    auto insideDoubleQuotes = false;
+    auto insideSingleQuotes = false;
 
     for (auto cursor = 0zu; cursor < line.size(); cursor += 1)
     {
@@ -28,6 +30,8 @@ static Generator<Token> next_token(std::string_view line)
             space += 1; cursor += 1;
         }
 
+        if (cursor == line.size()) break;
+
         if (space % 4 == 0) depth += space / 4;
 
         if (line.at(cursor) == '<')
@@ -38,7 +42,8 @@ static Generator<Token> next_token(std::string_view line)
         {
             co_yield Token { .data = { line.at(cursor) }, .type = Token::Type::RIGHT_ANGLE, .location = { {}, { {}, cursor } }, .depth = depth  };
 
-            if (!(cursor < line.size() && (std::isalpha(line.at(cursor+1)) || std::isdigit(line.at(cursor+1)))))
+            // text starts right after the tag, and can't start with a space since those only ever indent.
+            if (!(cursor + 1 < line.size() && line.at(cursor+1) != '<' && line.at(cursor+1) != ' '))
             {
                 continue;
             }
@@ -78,7 +83,10 @@ static Generator<Token> next_token(std::string_view line)
         {
             co_yield Token { .data = { line.at(cursor) }, .type = Token::Type::DOUBLE_QUOTE, .location = { {}, { {}, cursor } }, .depth = depth  };
 
-            if (!(cursor < line.size() && ((std::isalpha(line.at(cursor+1)) || std::isdigit(line.at(cursor+1))) || line.at(cursor+1) == '$' || line.at(cursor+1) == '{' || line.at(cursor+1) == '}')))
+            // only an opening quote starts a value, whatever the value starts with.
+            insideDoubleQuotes = !insideDoubleQuotes;
+
+            if (!(insideDoubleQuotes && cursor + 1 < line.size() && line.at(cursor+1) != '"'))
             {
                 continue;
             }
@@ -107,7 +115,9 @@ static Generator<Token> next_token(std::string_view line)
         {
             co_yield Token { .data = { line.at(cursor) }, .type = Token::Type::SINGLE_QUOTE, .location = { {}, { {}, cursor } }, .depth = depth  };
 
-            if (!(cursor < line.size() && ((std::isalpha(line.at(cursor+1)) || std::isdigit(line.at(cursor+1))) || line.at(cursor+1) == '$' || line.at(cursor+1) == '{' || line.at(cursor+1) == '}')))
+            insideSingleQuotes = !insideSingleQuotes;
+
+            if (!(insideSingleQuotes && cursor + 1 < line.size() && line.at(cursor+1) != '\''))
             {
                 continue;
             }
@@ -1,6 +1,13 @@
 #include "codegen/Assembler.hpp"
 #include "codegen/Compiler.hpp"
+#include "codegen/Inliner.hpp"
+#include "codegen/Peephole.hpp"
+#include "codegen/SlotAllocator.hpp"
+#include "codegen/TailCalls.hpp"
+#include "Analyzer.hpp"
+#include "Cache.hpp"
 #include "Lexer.hpp"
+#include "Optimizer.hpp"
 #include "Parser.hpp"
 
 #include <argparse/argparse.hpp>
@@ -20,6 +27,9 @@ Result<void> safe_main(std::span<char const*> arguments)
 
     cli.add_argument("-f", "--file").help("file to be compiled").required();
     cli.add_argument("-o", "--output").help("name of the generated bytecode file");
+    cli.add_argument("--no-cache").help("always parse the source instead of reusing a cached AST").flag();
+    cli.add_argument("--remarks").help("report every call the inliner considered and what it decided").flag();
+    cli.add_argument("--stats").help("report what the constant pool, dead code elimination, tail calls, peephole rules and slot allocation did").flag();
 
     argparse::ArgumentParser dump("dump", "", argparse::default_arguments::help);
     dump.add_description("dumps the result of a module to the standard output");
@@ -48,15 +58,31 @@ Result<void> safe_main(std::span<char const*> arguments)
         return make_error("source {} does not exist.", source);
     }
 
-    auto tokens = tokenize(source);
-
     if (dump["--tokens"] != false)
     {
-        std::cout << std::setw(4) << dump_tokens(tokens) << '\n';
+        std::cout << std::setw(4) << dump_tokens(tokenize(source)) << '\n';
         return {};
     }
 
-    auto ast = TRY(parse(tokens));
+    auto useCache = cli["--no-cache"] == false;
+    auto cacheEntry = useCache ? ast_cache_entry(source) : std::filesystem::path {};
+
+    auto ast = useCache ? load_cached_ast(cacheEntry) : nullptr;
+
+    if (!ast)
+    {
+        auto [partial, errors] = parse_partial(tokenize(source));
+
+        if (errors)
+        {
+            // the recovered tree is still worth looking at, even though it won't compile.
+            if (dump["--ast"] != false) std::cout << std::setw(4) << dump_ast(partial) << '\n';
+            return make_error("parsing failed with {} error(s)", errors);
+        }
+
+        ast = std::move(partial);
+        if (useCache) store_cached_ast(cacheEntry, ast);
+    }
 
     if (dump["--ast"] != false)
     {
@@ -64,15 +90,50 @@ Result<void> safe_main(std::span<char const*> arguments)
         return {};
     }
 
-    auto assembly = TRY(compile(ast));
+    TRY(analyze(ast));
+    auto optimization = TRY(optimize(ast));
+
+    auto module = TRY(compile(ast));
+    auto remarks = inline_functions(module);
+    auto tailCalls = optimize_tail_calls(module);
+    auto peephole = optimize_peephole(module);
+    auto slots = allocate_slots(module);
+
+    if (cli["--remarks"] != false)
+    {
+        for (auto const& remark : remarks)
+        {
+            fmt::print(stderr, "remark: {} '{}' into '{}', {}\n", remark.inlined ? "inlined" : "did not inline", remark.callee, remark.caller, remark.reason);
+        }
+    }
+
+    if (cli["--stats"] != false)
+    {
+        auto const& constants = module.constants;
+
+        // stderr, so that it never ends up mixed into a dump.
+        fmt::print(stderr, "constants: {} reference(s), {} distinct, {} byte(s), {} byte(s) saved\n",
+            constants.references, constants.entries.size(), constants.size, constants.savedBytes);
+        fmt::print(stderr, "dead code: {} function(s), {} statement(s) removed\n",
+            optimization.removedFunctions, optimization.removedStatements);
+
+        fmt::print(stderr, "tail calls: {} turned into jumps, {} reusing the frame\n", tailCalls.selfCalls, tailCalls.otherCalls);
+
+        for (auto const& [rule, count] : peephole)
+        {
+            fmt::print(stderr, "peephole: {} hit(s) of {}\n", count, rule);
+        }
+
+        fmt::print(stderr, "slots: {} before allocation, {} after\n", slots.slotsBefore, slots.slotsAfter);
+    }
 
     if (dump["--asm"] != false)
     {
-        std::cout << assembly << '\n';
+        std::cout << print_module(module) << '\n';
         return {};
     }
 
-    auto program = TRY(assemble(assembly));
+    auto program = TRY(assemble(module));
 
     auto output = [&] { return cli.has_value("--output") ? cli.get<std::string>("--output") : "program"; }();
     std::ofstream stream(fmt::format("{}.kubo", output), std::ios::binary);
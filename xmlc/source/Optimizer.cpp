@@ -0,0 +1,744 @@
+#include "Optimizer.hpp"
+#include "Diagnostic.hpp"
+#include "Intrinsics.hpp"
+
+#include <fmt/format.h>
+#include <liberror/Try.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace liberror;
+
+enum class OptimizerError
+{
+    DIVISION_BY_ZERO,
+    NUMBER_OVERFLOW,
+};
+
+struct Constant
+{
+    enum class Kind { NUMBER, STRING };
+
+    Kind kind {};
+    int32_t number {};
+    std::string text {};
+};
+
+struct Binding
+{
+    size_t slot {};
+    // left empty when the value is only known at run time.
+    std::optional<Constant> value {};
+};
+
+struct Folding
+{
+    std::unordered_map<std::string_view, Binding> variables {};
+    size_t errors {};
+};
+
+static void emit_optimizer_error(Folding& folding, OptimizerError const& error, std::vector<Issue> const& issues)
+{
+    folding.errors += 1;
+
+    switch (error)
+    {
+    case OptimizerError::DIVISION_BY_ZERO: { emit_diagnostic(Severity::ERROR, "division by zero", issues); break; }
+    case OptimizerError::NUMBER_OVERFLOW: { emit_diagnostic(Severity::ERROR, "number overflow", issues); break; }
+    }
+}
+
+static bool is_number(std::string_view value)
+{
+    if (value.starts_with('-')) value.remove_prefix(1);
+    return !value.empty() && std::ranges::all_of(value, ::isdigit);
+}
+
+static std::string constant_text(Constant const& constant)
+{
+    return constant.kind == Constant::Kind::NUMBER ? std::to_string(constant.number) : constant.text;
+}
+
+static bool is_truthy(Constant const& constant)
+{
+    return constant.kind == Constant::Kind::NUMBER ? constant.number != 0 : !constant.text.empty();
+}
+
+static std::optional<Constant> constant_of(Folding const& folding, Node const* node)
+{
+    if (!node || node->node_type() != Node::Type::EXPRESSION) return std::nullopt;
+    if (static_cast<Expression const*>(node)->expr_type() != Expression::Type::LITERAL) return std::nullopt;
+
+    auto literal = static_cast<LiteralExpr const*>(node);
+
+    if (literal->segments.empty())
+    {
+        if (!is_number(literal->value)) return Constant { .kind = Constant::Kind::STRING, .text = literal->value };
+
+        Constant constant { .kind = Constant::Kind::NUMBER };
+
+        // a number too big for the bytecode is reported by codegen, folding just leaves it alone.
+        if (auto [end, error] = std::from_chars(literal->value.data(), literal->value.data() + literal->value.size(), constant.number); error != std::errc {})
+        {
+            return std::nullopt;
+        }
+
+        return constant;
+    }
+
+    auto const& segments = literal->segments;
+
+    if (segments.size() == 1 && segments.front().kind == Segment::Kind::VARIABLE)
+    {
+        auto variable = folding.variables.find(std::string_view(literal->value).substr(segments.front().offset, segments.front().size));
+        if (variable != folding.variables.end()) return variable->second.value;
+    }
+
+    return std::nullopt;
+}
+
+static std::unique_ptr<Node> make_literal(Token const& token, Constant const& constant)
+{
+    auto literal = std::make_unique<LiteralExpr>();
+    literal->token = token;
+    literal->value = constant_text(constant);
+    return literal;
+}
+
+// Substitutes every interpolated variable with a known value, which is all the string concatenation there is.
+static void fold_literal_expression(Folding& folding, LiteralExpr* literal)
+{
+    if (literal->segments.empty()) return;
+
+    std::string value {};
+    std::vector<Segment> segments {};
+
+    for (auto const& segment : literal->segments)
+    {
+        auto text = std::string_view(literal->value).substr(segment.offset, segment.size);
+
+        if (segment.kind == Segment::Kind::VARIABLE)
+        {
+            auto variable = folding.variables.find(text);
+
+            if (variable == folding.variables.end() || !variable->second.value.has_value())
+            {
+                auto moved = segment;
+                moved.offset = value.size() + 2;
+                segments.push_back(moved);
+                value += fmt::format("${{{}}}", text);
+                continue;
+            }
+
+            value += constant_text(*variable->second.value);
+        }
+        else
+        {
+            value += text;
+        }
+    }
+
+    // every variable was substituted and what is left reads as a number, which is not what the string was.
+    if (segments.empty() && is_number(value)) return;
+
+    // the text in between is recomputed in one go, since substituted values merge with their neighbours.
+    std::vector<Segment> merged {};
+    auto start = 0zu;
+
+    for (auto const& segment : segments)
+    {
+        if (segment.offset - 2 > start) merged.push_back({ Segment::Kind::TEXT, start, segment.offset - 2 - start });
+        merged.push_back(segment);
+        start = segment.offset + segment.size + 1;
+    }
+
+    if (!segments.empty() && start < value.size()) merged.push_back({ Segment::Kind::TEXT, start, value.size() - start });
+
+    // a literal left naming a single variable has to load it, and only the analyzer hands out slots for those.
+    if (merged.size() == 1 && !literal->slot.has_value())
+    {
+        auto name = std::string_view(value).substr(merged.front().offset, merged.front().size);
+        literal->slot = folding.variables.at(name).slot;
+    }
+    else if (merged.size() != 1)
+    {
+        literal->slot.reset();
+    }
+
+    literal->value = std::move(value);
+    literal->segments = std::move(merged);
+}
+
+static std::optional<int64_t> fold_arithmetic(Folding& folding, ArithmeticExpr const* expression, int64_t lhs, int64_t rhs)
+{
+    switch (expression->op)
+    {
+    case ArithmeticExpr::Operator::ADD: return lhs + rhs;
+    case ArithmeticExpr::Operator::SUBTRACT: return lhs - rhs;
+    case ArithmeticExpr::Operator::MULTIPLY: return lhs * rhs;
+    case ArithmeticExpr::Operator::NEGATE: return -lhs;
+    case ArithmeticExpr::Operator::DIVIDE:
+    case ArithmeticExpr::Operator::MODULO: {
+        if (rhs == 0)
+        {
+            emit_optimizer_error(folding, OptimizerError::DIVISION_BY_ZERO, {{ expression->token, "divides by a value that is always zero" }});
+            return std::nullopt;
+        }
+
+        return expression->op == ArithmeticExpr::Operator::DIVIDE ? lhs / rhs : lhs % rhs;
+    }
+    }
+
+    return std::nullopt;
+}
+
+static std::optional<int32_t> fold_logical(LogicalExpr const* expression, Constant const& lhs, std::optional<Constant> const& rhs)
+{
+    switch (expression->op)
+    {
+    case LogicalExpr::Operator::NOT: return !is_truthy(lhs);
+    // the other side only matters when this one doesn't already decide the result.
+    case LogicalExpr::Operator::AND: if (!is_truthy(lhs)) return 0; break;
+    case LogicalExpr::Operator::OR: if (is_truthy(lhs)) return 1; break;
+    case LogicalExpr::Operator::EQUAL:
+    case LogicalExpr::Operator::NOT_EQUAL:
+    case LogicalExpr::Operator::LESS:
+    case LogicalExpr::Operator::LESS_EQUAL:
+    case LogicalExpr::Operator::GREATER:
+    case LogicalExpr::Operator::GREATER_EQUAL: break;
+    }
+
+    if (!rhs.has_value()) return std::nullopt;
+
+    switch (expression->op)
+    {
+    case LogicalExpr::Operator::AND:
+    case LogicalExpr::Operator::OR: return is_truthy(*rhs);
+    case LogicalExpr::Operator::EQUAL: return constant_text(lhs) == constant_text(*rhs);
+    case LogicalExpr::Operator::NOT_EQUAL: return constant_text(lhs) != constant_text(*rhs);
+    case LogicalExpr::Operator::LESS: return lhs.number < rhs->number;
+    case LogicalExpr::Operator::LESS_EQUAL: return lhs.number <= rhs->number;
+    case LogicalExpr::Operator::GREATER: return lhs.number > rhs->number;
+    case LogicalExpr::Operator::GREATER_EQUAL: return lhs.number >= rhs->number;
+    case LogicalExpr::Operator::NOT: break;
+    }
+
+    return std::nullopt;
+}
+
+static void fold_expression(Folding& folding, std::unique_ptr<Node>& node);
+
+static void fold_expressions(Folding& folding, std::vector<std::unique_ptr<Node>>& nodes)
+{
+    for (auto& node : nodes) fold_expression(folding, node);
+}
+
+static void fold_expression(Folding& folding, std::unique_ptr<Node>& node)
+{
+    if (!node || node->node_type() != Node::Type::EXPRESSION) return;
+
+    auto expression = static_cast<Expression*>(node.get());
+
+    switch (expression->expr_type())
+    {
+    case Expression::Type::ARG: return fold_expression(folding, static_cast<ArgExpr*>(expression)->value);
+    case Expression::Type::CALL: return fold_expressions(folding, static_cast<CallExpr*>(expression)->arguments);
+    case Expression::Type::LITERAL: {
+        auto literal = static_cast<LiteralExpr*>(expression);
+
+        // codegen tells numbers from strings by their text, so a string made only of digits has to stay a variable.
+        if (auto constant = constant_of(folding, literal); constant.has_value() && literal->slot.has_value()
+            && !(constant->kind == Constant::Kind::STRING && is_number(constant->text)))
+        {
+            node = make_literal(literal->token, *constant);
+            return;
+        }
+
+        return fold_literal_expression(folding, literal);
+    }
+    case Expression::Type::ARITHMETIC: {
+        auto arithmeticExpr = static_cast<ArithmeticExpr*>(expression);
+
+        fold_expression(folding, arithmeticExpr->lhs);
+        fold_expression(folding, arithmeticExpr->rhs);
+
+        auto lhs = constant_of(folding, arithmeticExpr->lhs.get());
+        auto rhs = arithmeticExpr->rhs ? constant_of(folding, arithmeticExpr->rhs.get()) : Constant {};
+
+        if (!lhs.has_value() || !rhs.has_value()) return;
+        if (lhs->kind != Constant::Kind::NUMBER || rhs->kind != Constant::Kind::NUMBER) return;
+
+        auto result = fold_arithmetic(folding, arithmeticExpr, lhs->number, rhs->number);
+
+        if (!result.has_value()) return;
+
+        if (*result < std::numeric_limits<int32_t>::min() || *result > std::numeric_limits<int32_t>::max())
+        {
+            emit_optimizer_error(folding, OptimizerError::NUMBER_OVERFLOW, {{ arithmeticExpr->token, "evaluates to a number that does not fit in 32 bits" }});
+            return;
+        }
+
+        node = make_literal(arithmeticExpr->token, { .kind = Constant::Kind::NUMBER, .number = int32_t(*result) });
+
+        return;
+    }
+    case Expression::Type::LOGICAL: {
+        auto logicalExpr = static_cast<LogicalExpr*>(expression);
+
+        fold_expression(folding, logicalExpr->lhs);
+        fold_expression(folding, logicalExpr->rhs);
+
+        auto lhs = constant_of(folding, logicalExpr->lhs.get());
+
+        if (!lhs.has_value()) return;
+
+        if (auto result = fold_logical(logicalExpr, *lhs, constant_of(folding, logicalExpr->rhs.get())))
+        {
+            node = make_literal(logicalExpr->token, { .kind = Constant::Kind::NUMBER, .number = *result });
+        }
+
+        return;
+    }
+    }
+}
+
+static void fold_scope(Folding& folding, std::vector<std::unique_ptr<Node>>& scope);
+
+static void fold_statement(Folding& folding, std::unique_ptr<Node>& node, std::vector<std::unique_ptr<Node>>& folded)
+{
+    if (node->node_type() != Node::Type::STATEMENT)
+    {
+        fold_expression(folding, node);
+        folded.push_back(std::move(node));
+        return;
+    }
+
+    auto statement = static_cast<Statement*>(node.get());
+
+    switch (statement->stmt_type())
+    {
+    case Statement::Type::LET: {
+        auto letStmt = static_cast<LetStmt*>(statement);
+
+        fold_expression(folding, letStmt->value);
+
+        auto value = constant_of(folding, letStmt->value.get());
+
+        // the declared type is what the value is, whatever its text looks like.
+        if (value.has_value() && letStmt->type != "number" && value->kind == Constant::Kind::NUMBER)
+        {
+            value = Constant { .kind = Constant::Kind::STRING, .text = constant_text(*value) };
+        }
+
+        folding.variables.insert_or_assign(letStmt->name, Binding { letStmt->slot, std::move(value) });
+
+        break;
+    }
+    case Statement::Type::RETURN: {
+        fold_expression(folding, static_cast<RetStmt*>(statement)->value);
+        break;
+    }
+    case Statement::Type::IF: {
+        auto ifStmt = static_cast<IfStmt*>(statement);
+
+        fold_expression(folding, ifStmt->condition);
+
+        if (auto condition = constant_of(folding, ifStmt->condition.get()))
+        {
+            auto& branch = is_truthy(*condition) ? ifStmt->trueBranch : ifStmt->falseBranch;
+
+            // the analyzer already kept the branch's variables from being used past it, so it can be spliced in as is.
+            for (auto& child : branch) fold_statement(folding, child, folded);
+
+            return;
+        }
+
+        fold_scope(folding, ifStmt->trueBranch);
+        fold_scope(folding, ifStmt->falseBranch);
+
+        break;
+    }
+    }
+
+    folded.push_back(std::move(node));
+}
+
+static void fold_scope(Folding& folding, std::vector<std::unique_ptr<Node>>& scope)
+{
+    std::vector<std::unique_ptr<Node>> folded {};
+    folded.reserve(scope.size());
+
+    for (auto& node : scope) fold_statement(folding, node, folded);
+
+    scope = std::move(folded);
+}
+
+static void fold_function_declaration(Folding& folding, FunctionDecl* declaration)
+{
+    folding.variables.clear();
+
+    for (auto slot = 0zu; auto const& [name, _] : declaration->parameters)
+    {
+        folding.variables.insert_or_assign(name, Binding { slot++, std::nullopt });
+    }
+
+    fold_scope(folding, declaration->scope);
+}
+
+static void fold_program_declaration(Folding& folding, ProgramDecl* declaration)
+{
+    for (auto const& child : declaration->scope)
+    {
+        if (child->node_type() == Node::Type::DECLARATION && static_cast<Declaration const*>(child.get())->decl_type() == Declaration::Type::FUNCTION)
+        {
+            fold_function_declaration(folding, static_cast<FunctionDecl*>(child.get()));
+        }
+    }
+
+    folding.variables.clear();
+
+    std::vector<std::unique_ptr<Node>> folded {};
+    folded.reserve(declaration->scope.size());
+
+    for (auto& child : declaration->scope)
+    {
+        if (child->node_type() == Node::Type::DECLARATION) folded.push_back(std::move(child));
+        else fold_statement(folding, child, folded);
+    }
+
+    declaration->scope = std::move(folded);
+}
+
+struct Uses
+{
+    std::vector<size_t> functions {};
+    std::unordered_set<size_t> slots {};
+};
+
+static void collect_uses(Node const* node, Uses& uses);
+
+static void collect_uses(std::vector<std::unique_ptr<Node>> const& nodes, Uses& uses)
+{
+    for (auto const& node : nodes) collect_uses(node.get(), uses);
+}
+
+static void collect_uses(Node const* node, Uses& uses)
+{
+    if (!node) return;
+
+    switch (node->node_type())
+    {
+    case Node::Type::EXPRESSION: {
+        auto expression = static_cast<Expression const*>(node);
+
+        switch (expression->expr_type())
+        {
+        case Expression::Type::ARG: return collect_uses(static_cast<ArgExpr const*>(expression)->value.get(), uses);
+        case Expression::Type::ARITHMETIC: {
+            auto arithmeticExpr = static_cast<ArithmeticExpr const*>(expression);
+            collect_uses(arithmeticExpr->lhs.get(), uses);
+            return collect_uses(arithmeticExpr->rhs.get(), uses);
+        }
+        case Expression::Type::LOGICAL: {
+            auto logicalExpr = static_cast<LogicalExpr const*>(expression);
+            collect_uses(logicalExpr->lhs.get(), uses);
+            return collect_uses(logicalExpr->rhs.get(), uses);
+        }
+        case Expression::Type::CALL: {
+            auto callExpr = static_cast<CallExpr const*>(expression);
+            if (callExpr->callee.kind == Callee::Kind::FUNCTION) uses.functions.push_back(callExpr->callee.index);
+            return collect_uses(callExpr->arguments, uses);
+        }
+        case Expression::Type::LITERAL: {
+            auto literal = static_cast<LiteralExpr const*>(expression);
+
+            if (literal->slot.has_value()) uses.slots.insert(*literal->slot);
+
+            for (auto const& segment : literal->segments)
+            {
+                if (segment.slot.has_value()) uses.slots.insert(*segment.slot);
+            }
+
+            return;
+        }
+        }
+
+        break;
+    }
+    case Node::Type::STATEMENT: {
+        auto statement = static_cast<Statement const*>(node);
+
+        switch (statement->stmt_type())
+        {
+        case Statement::Type::IF: {
+            auto ifStmt = static_cast<IfStmt const*>(statement);
+            collect_uses(ifStmt->condition.get(), uses);
+            collect_uses(ifStmt->trueBranch, uses);
+            return collect_uses(ifStmt->falseBranch, uses);
+        }
+        case Statement::Type::LET: return collect_uses(static_cast<LetStmt const*>(statement)->value.get(), uses);
+        case Statement::Type::RETURN: return collect_uses(static_cast<RetStmt const*>(statement)->value.get(), uses);
+        }
+
+        break;
+    }
+    case Node::Type::DECLARATION: return collect_uses(static_cast<Declaration const*>(node)->scope, uses);
+    case Node::Type::ERROR: break;
+    }
+}
+
+static void remap_callees(Node* node, std::vector<size_t> const& indices);
+
+static void remap_callees(std::vector<std::unique_ptr<Node>> const& nodes, std::vector<size_t> const& indices)
+{
+    for (auto const& node : nodes) remap_callees(node.get(), indices);
+}
+
+static void remap_callees(Node* node, std::vector<size_t> const& indices)
+{
+    if (!node) return;
+
+    switch (node->node_type())
+    {
+    case Node::Type::EXPRESSION: {
+        auto expression = static_cast<Expression*>(node);
+
+        if (expression->expr_type() == Expression::Type::ARG) return remap_callees(static_cast<ArgExpr*>(expression)->value.get(), indices);
+
+        if (expression->expr_type() == Expression::Type::CALL)
+        {
+            auto callExpr = static_cast<CallExpr*>(expression);
+            if (callExpr->callee.kind == Callee::Kind::FUNCTION) callExpr->callee.index = indices.at(callExpr->callee.index);
+            return remap_callees(callExpr->arguments, indices);
+        }
+
+        break;
+    }
+    case Node::Type::STATEMENT: {
+        auto statement = static_cast<Statement*>(node);
+
+        switch (statement->stmt_type())
+        {
+        case Statement::Type::IF: {
+            auto ifStmt = static_cast<IfStmt*>(statement);
+            remap_callees(ifStmt->trueBranch, indices);
+            return remap_callees(ifStmt->falseBranch, indices);
+        }
+        case Statement::Type::LET: return remap_callees(static_cast<LetStmt*>(statement)->value.get(), indices);
+        case Statement::Type::RETURN: return remap_callees(static_cast<RetStmt*>(statement)->value.get(), indices);
+        }
+
+        break;
+    }
+    case Node::Type::DECLARATION: return remap_callees(static_cast<Declaration*>(node)->scope, indices);
+    case Node::Type::ERROR: break;
+    }
+}
+
+static bool is_function(std::unique_ptr<Node> const& node)
+{
+    return node->node_type() == Node::Type::DECLARATION && static_cast<Declaration const*>(node.get())->decl_type() == Declaration::Type::FUNCTION;
+}
+
+// Only functions the entrypoint can reach through the call graph are kept, and since calls refer to functions by their
+// position, every call left is renumbered to match.
+static void eliminate_unreachable_functions(OptimizationStats& stats, ProgramDecl* program)
+{
+    std::vector<FunctionDecl const*> functions {};
+
+    for (auto const& child : program->scope)
+    {
+        if (is_function(child)) functions.push_back(static_cast<FunctionDecl const*>(child.get()));
+    }
+
+    Uses roots {};
+
+    for (auto const& child : program->scope)
+    {
+        if (!is_function(child)) collect_uses(child.get(), roots);
+    }
+
+    std::vector<bool> reachable(functions.size());
+    auto pending = std::move(roots.functions);
+
+    while (!pending.empty())
+    {
+        auto index = pending.back();
+        pending.pop_back();
+
+        if (reachable.at(index)) continue;
+
+        reachable.at(index) = true;
+
+        Uses uses {};
+        collect_uses(functions.at(index), uses);
+        std::ranges::copy(uses.functions, std::back_inserter(pending));
+    }
+
+    if (std::ranges::all_of(reachable, std::identity {})) return;
+
+    std::vector<size_t> indices(functions.size());
+
+    for (auto index = 0zu, kept = 0zu; index < functions.size(); index += 1)
+    {
+        if (reachable[index]) indices[index] = kept++;
+    }
+
+    auto removed = std::erase_if(program->scope, [&, index = 0zu] (std::unique_ptr<Node> const& child) mutable {
+        return is_function(child) && !reachable[index++];
+    });
+
+    stats.removedFunctions += removed;
+
+    remap_callees(program->scope, indices);
+}
+
+// whether evaluating the node could do anything besides produce its value, which only calls to functions and to impure
+// intrinsics can.
+static bool has_side_effects(Node const* node)
+{
+    if (!node || node->node_type() != Node::Type::EXPRESSION) return false;
+
+    auto expression = static_cast<Expression const*>(node);
+
+    switch (expression->expr_type())
+    {
+    case Expression::Type::ARG: return has_side_effects(static_cast<ArgExpr const*>(expression)->value.get());
+    case Expression::Type::ARITHMETIC: {
+        auto arithmeticExpr = static_cast<ArithmeticExpr const*>(expression);
+        return has_side_effects(arithmeticExpr->lhs.get()) || has_side_effects(arithmeticExpr->rhs.get());
+    }
+    case Expression::Type::LOGICAL: {
+        auto logicalExpr = static_cast<LogicalExpr const*>(expression);
+        return has_side_effects(logicalExpr->lhs.get()) || has_side_effects(logicalExpr->rhs.get());
+    }
+    case Expression::Type::CALL: {
+        auto callExpr = static_cast<CallExpr const*>(expression);
+
+        if (callExpr->callee.kind != Callee::Kind::INTRINSIC || !INTRINSICS.at(callExpr->callee.index).pure) return true;
+
+        return std::ranges::any_of(callExpr->arguments, [] (std::unique_ptr<Node> const& argument) { return has_side_effects(argument.get()); });
+    }
+    case Expression::Type::LITERAL: return false;
+    }
+
+    return true;
+}
+
+// Drops the lets nothing reads and the calls nobody needs, along with anything that follows a return in the same block.
+// A let of a call with side effects still makes the call, it only stops keeping the result.
+static bool eliminate_dead_statements(OptimizationStats& stats, std::vector<std::unique_ptr<Node>>& scope, Uses const& uses)
+{
+    auto changed = false;
+
+    if (auto ret = std::ranges::find_if(scope, [] (std::unique_ptr<Node> const& node) {
+        return node->node_type() == Node::Type::STATEMENT && static_cast<Statement const*>(node.get())->stmt_type() == Statement::Type::RETURN;
+    }); ret != scope.end() && std::next(ret) != scope.end())
+    {
+        stats.removedStatements += size_t(std::distance(std::next(ret), scope.end()));
+        scope.erase(std::next(ret), scope.end());
+        changed = true;
+    }
+
+    std::vector<std::unique_ptr<Node>> kept {};
+    kept.reserve(scope.size());
+
+    for (auto& node : scope)
+    {
+        if (node->node_type() == Node::Type::EXPRESSION && !has_side_effects(node.get()))
+        {
+            stats.removedStatements += 1;
+            changed = true;
+            continue;
+        }
+
+        if (node->node_type() != Node::Type::STATEMENT)
+        {
+            kept.push_back(std::move(node));
+            continue;
+        }
+
+        auto statement = static_cast<Statement*>(node.get());
+
+        if (statement->stmt_type() == Statement::Type::IF)
+        {
+            auto ifStmt = static_cast<IfStmt*>(statement);
+            changed |= eliminate_dead_statements(stats, ifStmt->trueBranch, uses);
+            changed |= eliminate_dead_statements(stats, ifStmt->falseBranch, uses);
+        }
+
+        if (statement->stmt_type() != Statement::Type::LET)
+        {
+            kept.push_back(std::move(node));
+            continue;
+        }
+
+        auto letStmt = static_cast<LetStmt*>(statement);
+
+        if (uses.slots.contains(letStmt->slot))
+        {
+            kept.push_back(std::move(node));
+            continue;
+        }
+
+        stats.removedStatements += 1;
+        changed = true;
+
+        if (has_side_effects(letStmt->value.get()))
+        {
+            static_cast<CallExpr*>(letStmt->value.get())->discarded = true;
+            kept.push_back(std::move(letStmt->value));
+        }
+    }
+
+    scope = std::move(kept);
+
+    return changed;
+}
+
+static void eliminate_dead_code(OptimizationStats& stats, ProgramDecl* program)
+{
+    eliminate_unreachable_functions(stats, program);
+
+    for (auto const& child : program->scope)
+    {
+        if (!is_function(child)) continue;
+
+        auto function = static_cast<FunctionDecl*>(child.get());
+
+        // dropping a let can leave the ones it read from unused as well.
+        for (auto changed = true; changed; )
+        {
+            Uses uses {};
+            collect_uses(function, uses);
+            changed = eliminate_dead_statements(stats, function->scope, uses);
+        }
+    }
+}
+
+Result<OptimizationStats> optimize(std::unique_ptr<Node> const& ast)
+{
+    Folding folding {};
+    OptimizationStats stats {};
+
+    auto program = static_cast<ProgramDecl*>(ast.get());
+
+    fold_program_declaration(folding, program);
+
+    if (folding.errors)
+    {
+        return make_error("optimization failed with {} error(s)", folding.errors);
+    }
+
+    eliminate_dead_code(stats, program);
+
+    return stats;
+}
@@ -1,22 +1,19 @@
 #include "Parser.hpp"
+#include "Diagnostic.hpp"
 
 #include <magic_enum/magic_enum.hpp>
-#include <libcoro/Generator.hpp>
 #include <liberror/Result.hpp>
 #include <liberror/Try.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
 #include <iostream>
-#include <fstream>
+#include <tuple>
 
-using namespace libcoro;
 using namespace liberror;
 
-auto static constexpr RED = "\033[31m";
-auto static constexpr GREEN = "\033[32m";
-auto static constexpr BLUE = "\033[34m";
-auto static constexpr YELLOW = "\033[33m";
-auto static constexpr RESET = "\033[00m";
-
 enum class ParserError
 {
     UNEXPECTED_TOKEN_REACHED,
@@ -25,77 +22,36 @@ enum class ParserError
     ENCLOSING_TOKEN_MISMATCH,
     UNEXPECTED_END_OF_FILE,
     MISSING_RETURN_STATEMENT,
+    UNSUPPORTED_CONSTRUCT,
 };
 
-static auto hadAnError_g = false;
+// past this many errors the rest are only counted, which keeps reporting on badly broken inputs bounded.
+static constexpr size_t MAX_REPORTED_ERRORS = 32;
+// how many `(`, `!` and `-` an infix expression may open before the parser gives up on it instead of the stack.
+static constexpr size_t MAX_INFIX_NESTING = 256;
 
-static Generator<std::string> next_line(std::filesystem::path const& path)
+struct ParserContext
 {
-    std::ifstream stream(path);
-
-    for (std::string line; std::getline(stream, line); )
-    {
-        co_yield line;
-    }
-
-    co_return;
-}
+    std::vector<Token> const& tokens;
+    size_t errors {};
+};
 
-static void emit_parser_error(ParserError const& error, std::vector<std::pair<Token, std::string_view>> const& issues)
+static void emit_parser_error(ParserContext& context, ParserError const& error, std::vector<Issue> const& issues)
 {
-    hadAnError_g = true;
-
-    std::vector<std::string> lines {};
-
-    for (auto const& line : next_line(issues.at(0).first.location.first))
-    {
-        // cppcheck-suppress [useStlAlgorithm]
-        lines.push_back(line);
-    }
+    context.errors += 1;
 
-    std::cout << RED << "[error]: " << RESET;
+    if (context.errors > MAX_REPORTED_ERRORS) return;
 
     switch (error)
     {
-    case ParserError::UNEXPECTED_TOKEN_REACHED: { std::cout << "unexpected token"; break; }
-    case ParserError::EXPECTED_TOKEN_MISSING: { std::cout << "missing expected token"; break; }
-    case ParserError::ENCLOSING_TOKEN_MISSING: { std::cout << " missing enclosing token"; break; }
-    case ParserError::ENCLOSING_TOKEN_MISMATCH: { std::cout << "mismatching tokens found"; break; }
-    case ParserError::MISSING_RETURN_STATEMENT: { std::cout << "missing return statement"; break; }
-    case ParserError::UNEXPECTED_END_OF_FILE: { std::cout << "unexpected end of file"; break; }
+    case ParserError::UNEXPECTED_TOKEN_REACHED: { emit_diagnostic(Severity::ERROR, "unexpected token", issues); break; }
+    case ParserError::EXPECTED_TOKEN_MISSING: { emit_diagnostic(Severity::ERROR, "missing expected token", issues); break; }
+    case ParserError::ENCLOSING_TOKEN_MISSING: { emit_diagnostic(Severity::ERROR, " missing enclosing token", issues); break; }
+    case ParserError::ENCLOSING_TOKEN_MISMATCH: { emit_diagnostic(Severity::ERROR, "mismatching tokens found", issues); break; }
+    case ParserError::MISSING_RETURN_STATEMENT: { emit_diagnostic(Severity::ERROR, "missing return statement", issues); break; }
+    case ParserError::UNEXPECTED_END_OF_FILE: { emit_diagnostic(Severity::ERROR, "unexpected end of file", issues); break; }
+    case ParserError::UNSUPPORTED_CONSTRUCT: { emit_diagnostic(Severity::ERROR, "unsupported construct", issues); break; }
     }
-
-    std::cout << '\n';
-
-    for (auto const& [token, message] : issues)
-    {
-        auto& [data, type, location, depth] = token;
-        auto& [file, position] = location;
-        auto& [line, column] = position;
-
-        auto beforeToken = lines.at(line).substr(0, 1+column-data.size());
-        auto afterToken  = column ? lines.at(line).substr(1+column) : "";
-
-        std::cout << '\n';
-        std::cout << "at " << file.string() << ':' << line+1 << ':' << beforeToken.size() + 1<< '\n';
-        std::cout << '\n';
-
-        auto index = beforeToken.find_first_not_of(' ');
-
-        if (index != std::string::npos)
-        {
-            beforeToken = beforeToken.substr(index);
-        }
-        else if (std::all_of(beforeToken.begin(), beforeToken.end(), ::isspace))
-        {
-            beforeToken = "";
-        }
-
-        std::cout << GREEN << std::right << std::setw(4) << line+1 << RESET << " | " << beforeToken << BLUE << token.data << RESET << afterToken << '\n';
-        std::cout << "    " << " | " << std::string(beforeToken.size(), ' ') << RED << std::string(data.size(), '^') << RESET << ' ' << message << '\n';
-    }
-
-    std::cout << '\n';
 }
 
 enum class ParserWarning
@@ -103,57 +59,17 @@ enum class ParserWarning
     UNEXPECTED_TOKEN_POSITION
 };
 
-static void emit_parser_warning(ParserWarning const& warning, std::vector<std::pair<Token, std::string_view>> const& issues)
+static void emit_parser_warning(ParserWarning const& warning, std::vector<Issue> const& issues)
 {
-    std::vector<std::string> lines {};
-
-    for (auto const& line : next_line(issues.at(0).first.location.first))
-    {
-        // cppcheck-suppress [useStlAlgorithm]
-        lines.push_back(line);
-    }
-
-    std::cout << YELLOW << "[warning]: " << RESET;
-
     switch (warning)
     {
-    case ParserWarning::UNEXPECTED_TOKEN_POSITION: { std::cout << "unexpected token position"; break; }
-    }
-
-    std::cout << '\n';
-
-    for (auto const& [token, message] : issues)
-    {
-        auto& [data, type, location, depth] = token;
-        auto& [file, position] = location;
-        auto& [line, column] = position;
-
-        auto beforeToken = lines.at(line).substr(0, 1+column-data.size());
-        auto afterToken  = column ? lines.at(line).substr(1+column) : "";
-
-        std::cout << '\n';
-        std::cout << "at " << file.string() << ':' << line+1 << ':' << beforeToken.size() + 1<< '\n';
-        std::cout << '\n';
-
-        auto index = beforeToken.find_first_not_of(' ');
-
-        if (index != std::string::npos)
-        {
-            beforeToken = beforeToken.substr(index);
-        }
-        else if (std::all_of(beforeToken.begin(), beforeToken.end(), ::isspace))
-        {
-            beforeToken = "";
-        }
-
-        std::cout << GREEN << std::right << std::setw(4) << line+1 << RESET << " | " << beforeToken << BLUE << token.data << RESET << afterToken << '\n';
-        std::cout << "    " << " | " << std::string(beforeToken.size(), ' ') << YELLOW << std::string(data.size(), '^') << RESET << ' ' << message << '\n';
+    case ParserWarning::UNEXPECTED_TOKEN_POSITION: { emit_diagnostic(Severity::WARNING, "unexpected token position", issues); break; }
     }
 }
 
 static bool expect(std::vector<Token> const& tokens, int cursor, Token::Type type)
 {
-    if (cursor == -1 || tokens.at(static_cast<size_t>(cursor)).type != type)
+    if (cursor < 0 || tokens.at(static_cast<size_t>(cursor)).type != type)
     {
         return false;
     }
@@ -163,12 +79,12 @@ static bool expect(std::vector<Token> const& tokens, int cursor, Token::Type typ
 
 static bool expect(std::vector<Token> const& tokens, int cursor, Token::Type type, std::string_view data)
 {
-    if (cursor == -1 || tokens.at(static_cast<size_t>(cursor)).type != type)
+    if (cursor < 0 || tokens.at(static_cast<size_t>(cursor)).type != type)
     {
         return false;
     }
 
-    if (cursor == -1 || (tokens.at(static_cast<size_t>(cursor)).type == type && tokens.at(static_cast<size_t>(cursor)).data != data))
+    if (cursor < 0 || (tokens.at(static_cast<size_t>(cursor)).type == type && tokens.at(static_cast<size_t>(cursor)).data != data))
     {
         return false;
     }
@@ -176,13 +92,16 @@ static bool expect(std::vector<Token> const& tokens, int cursor, Token::Type typ
     return true;
 }
 
+// the token stream is reversed, so anything past its end reads as the END_OF_FILE token at the front.
 static Token peek(std::vector<Token> const& tokens, int cursor, int distance = 0)
 {
+    if (cursor - distance < 0) return tokens.front();
     return tokens.at(static_cast<size_t>(cursor - distance));
 }
 
 static Token advance(std::vector<Token> const& tokens, int& cursor)
 {
+    if (cursor < 0) return tokens.front();
     return tokens.at(static_cast<size_t>(cursor--));
 }
 
@@ -206,34 +125,42 @@ static Result<Token> advance(std::vector<Token> const& tokens, int& cursor, Toke
     return make_error({});
 }
 
-static bool is_next_statement(std::vector<Token> const& tokens, int cursor)
+static bool is_next_declaration(std::vector<Token> const& tokens, int cursor)
 {
     return
-        peek(tokens, cursor, 1).data == "let" ||
-        peek(tokens, cursor, 1).data == "call" ||
-        peek(tokens, cursor, 1).data == "arg" ||
-        peek(tokens, cursor, 1).data == "return"
+        peek(tokens, cursor, 1).data == "function"
         ;
 }
 
-static bool is_next_declaration(std::vector<Token> const& tokens, int cursor)
+static bool is_closing_tag(std::vector<Token> const& tokens, int cursor)
 {
-    return
-        peek(tokens, cursor, 1).data == "function"
-        ;
+    return peek(tokens, cursor).type == Token::Type::LEFT_ANGLE && peek(tokens, cursor, 1).type == Token::Type::SLASH;
+}
+
+static std::unique_ptr<Node> make_error_node(std::vector<Token> const& tokens, int start)
+{
+    auto errorNode = std::make_unique<ErrorNode>();
+    errorNode->token = peek(tokens, start).type == Token::Type::LEFT_ANGLE ? peek(tokens, start, 1) : peek(tokens, start);
+    return errorNode;
 }
 
-static void synchronize(std::vector<Token> const& tokens, Token const& token, int& cursor)
+// Skips past a construct that failed to parse, up to where one of its siblings may start: any opening tag no deeper
+// than a child of `parent`, or the closing tag of `parent` itself. The cursor never stays where the failed construct
+// started and never moves backwards, so recovery costs at most one visit per token over the whole parse.
+static void synchronize(std::vector<Token> const& tokens, Token const& parent, int start, int& cursor)
 {
-    while (
-        cursor > 2 &&
-        !(
-            (peek(tokens, cursor, 0).type == Token::Type::LEFT_ANGLE && peek(tokens, cursor, 1).type == Token::Type::KEYWORD &&
-             peek(tokens, cursor, 0).depth == token.depth + 1) ||
-             peek(tokens, cursor, 0).depth == token.depth
-        )
-    )
+    if (cursor == start) advance(tokens, cursor);
+
+    while (cursor > 0)
     {
+        auto const& token = tokens.at(static_cast<size_t>(cursor));
+
+        if (token.type == Token::Type::LEFT_ANGLE)
+        {
+            if (peek(tokens, cursor, 1).type != Token::Type::SLASH && token.depth <= parent.depth + 1) return;
+            if (peek(tokens, cursor, 1).type == Token::Type::SLASH && peek(tokens, cursor, 2).data == parent.data) return;
+        }
+
         advance(tokens, cursor);
     }
 }
@@ -241,16 +168,16 @@ static void synchronize(std::vector<Token> const& tokens, Token const& token, in
 using Property = std::pair<Token, std::unique_ptr<Node>>;
 using Tag = std::pair<Token, std::vector<Property>>;
 
-static Result<Tag> parse_opening_tag(std::vector<Token> const& tokens, int& cursor, std::string_view name);
-static Result<void> parse_closing_tag(std::vector<Token> const& tokens, int& cursor, Token const& tag);
+static Result<Tag> parse_opening_tag(ParserContext& context, int& cursor, std::string_view name);
+static Result<void> parse_closing_tag(ParserContext& context, int& cursor, Token const& tag);
 
-static Result<std::unique_ptr<Node>> parse_expression(std::vector<Token> const& tokens, int& cursor);
+static Result<std::unique_ptr<Node>> parse_expression(ParserContext& context, int& cursor);
 
-static Result<std::unique_ptr<Node>> parse_arg_expression(std::vector<Token> const& tokens, int& cursor)
+static Result<std::unique_ptr<Node>> parse_arg_expression(ParserContext& context, int& cursor)
 {
     auto argumentStmt = std::make_unique<ArgExpr>();
 
-    auto [tag, properties] = TRY(parse_opening_tag(tokens, cursor, "arg"));
+    auto [tag, properties] = TRY(parse_opening_tag(context, cursor, "arg"));
 
     argumentStmt->token = tag;
 
@@ -264,7 +191,7 @@ static Result<std::unique_ptr<Node>> parse_arg_expression(std::vector<Token> con
 
     if (!argumentStmt->value)
     {
-        auto value = TRY(parse_expression(tokens, cursor));
+        auto value = TRY(parse_expression(context, cursor));
 
         if (value)
         {
@@ -272,28 +199,28 @@ static Result<std::unique_ptr<Node>> parse_arg_expression(std::vector<Token> con
         }
         else
         {
-            emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ peek(tokens, cursor), "was found instead of 'value' property" }});
+            emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ peek(context.tokens, cursor), "was found instead of 'value' property" }});
             return make_error({});
         }
     }
 
-    TRY(parse_closing_tag(tokens, cursor, tag));
+    TRY(parse_closing_tag(context, cursor, tag));
 
     return argumentStmt;
 }
 
-static Result<std::unique_ptr<Node>> parse_call_expression(std::vector<Token> const& tokens, int& cursor)
+static Result<std::unique_ptr<Node>> parse_call_expression(ParserContext& context, int& cursor)
 {
     auto callExpr = std::make_unique<CallExpr>();
 
-    auto [tag, properties] = TRY(parse_opening_tag(tokens, cursor, "call"));
+    auto [tag, properties] = TRY(parse_opening_tag(context, cursor, "call"));
 
     callExpr->token = tag;
 
     auto maybeWho = std::ranges::find_if(properties, [] (auto&& current) { return current.data == "who"; }, &decltype(properties)::value_type::first);
     if (maybeWho == properties.end())
     {
-        emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'who'" }});
+        emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'who'" }});
         return make_error({});
     }
     else
@@ -303,9 +230,10 @@ static Result<std::unique_ptr<Node>> parse_call_expression(std::vector<Token> co
         callExpr->who = static_cast<LiteralExpr const*>(maybeWho->second.get())->value;
     }
 
-    while (cursor > 0 && peek(tokens, cursor).depth > tag.depth)
+    while (cursor > 0 && peek(context.tokens, cursor).depth > tag.depth && !is_closing_tag(context.tokens, cursor))
     {
-        auto argument = parse_arg_expression(tokens, cursor);
+        auto start = cursor;
+        auto argument = parse_arg_expression(context, cursor);
 
         if (argument.has_value() && argument.value())
         {
@@ -315,189 +243,401 @@ static Result<std::unique_ptr<Node>> parse_call_expression(std::vector<Token> co
 
         if (!argument.has_value())
         {
-            synchronize(tokens, tag, cursor);
+            callExpr->arguments.push_back(make_error_node(context.tokens, start));
+            synchronize(context.tokens, tag, start, cursor);
             continue;
         }
 
         break;
     }
 
-    TRY(parse_closing_tag(tokens, cursor, tag));
+    TRY(parse_closing_tag(context, cursor, tag));
 
     return callExpr;
 }
 
-static Result<std::unique_ptr<Node>> parse_expression(std::vector<Token> const& tokens, int& cursor)
+static Result<std::unique_ptr<Node>> parse_expression(ParserContext& context, int& cursor)
 {
-    if (peek(tokens, cursor).type == Token::Type::LITERAL)
+    if (peek(context.tokens, cursor).type == Token::Type::LITERAL)
     {
         auto literalExpr = std::make_unique<LiteralExpr>();
-        literalExpr->value = advance(tokens, cursor).data;
+        literalExpr->token = advance(context.tokens, cursor);
+        literalExpr->value = literalExpr->token.data;
+        literalExpr->segments = split_interpolations(literalExpr->value);
         return literalExpr;
     }
 
-    if (peek(tokens, cursor, 1).data == "call") return parse_call_expression(tokens, cursor);
-    if (peek(tokens, cursor, 1).data == "arg") return parse_arg_expression(tokens, cursor);
+    if (is_closing_tag(context.tokens, cursor)) return std::unique_ptr<Node> {};
 
-    assert("UNREACHABLE" && false);
+    if (peek(context.tokens, cursor, 1).data == "call") return parse_call_expression(context, cursor);
+    if (peek(context.tokens, cursor, 1).data == "arg") return parse_arg_expression(context, cursor);
+
+    emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor), "was found instead of an expression" }});
+    return make_error({});
 }
 
-static Result<Tag> parse_opening_tag(std::vector<Token> const& tokens, int& cursor, std::string_view name)
+static Result<Tag> parse_opening_tag(ParserContext& context, int& cursor, std::string_view name)
 {
-    if (!advance(tokens, cursor, Token::Type::LEFT_ANGLE))
+    if (!advance(context.tokens, cursor, Token::Type::LEFT_ANGLE))
     {
-        emit_parser_error(ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(tokens, cursor), "was found instead of a '<'" }});
+        emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor), "was found instead of a '<'" }});
         return make_error({});
     }
 
-    auto tag = advance(tokens, cursor, Token::Type::KEYWORD, name);
+    auto tag = advance(context.tokens, cursor, Token::Type::KEYWORD, name);
 
     if (!tag)
     {
-        emit_parser_error(ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(tokens, cursor), fmt::format("was found instead of a {}", name) }});
+        emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor), fmt::format("was found instead of a {}", name) }});
         return make_error({});
     }
 
     std::vector<Property> properties {};
 
-    while (cursor > 1 && peek(tokens, cursor).type != Token::Type::RIGHT_ANGLE)
+    while (cursor > 1 && peek(context.tokens, cursor).type != Token::Type::RIGHT_ANGLE)
     {
-        auto propertyName = advance(tokens, cursor, Token::Type::PROPERTY);
+        auto propertyName = advance(context.tokens, cursor, Token::Type::PROPERTY);
 
         if (!propertyName)
         {
-            emit_parser_error(ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(tokens, cursor), "was found instead of a property" }});
+            emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor), "was found instead of a property" }});
             return make_error({});
         }
 
-        if (!advance(tokens, cursor, Token::Type::EQUAL))
+        if (!advance(context.tokens, cursor, Token::Type::EQUAL))
         {
-            emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ peek(tokens, cursor), "was found instead of equals" }});
+            emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ peek(context.tokens, cursor), "was found instead of equals" }});
             return make_error({});
         }
 
-        if (!(advance(tokens, cursor, Token::Type::DOUBLE_QUOTE) || advance(tokens, cursor, Token::Type::SINGLE_QUOTE)))
+        if (!(advance(context.tokens, cursor, Token::Type::DOUBLE_QUOTE) || advance(context.tokens, cursor, Token::Type::SINGLE_QUOTE)))
         {
-            emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ peek(tokens, cursor), "was found instead of quotes" }});
+            emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ peek(context.tokens, cursor), "was found instead of quotes" }});
             return make_error({});
         }
 
-        auto propertyValue = parse_expression(tokens, cursor);
+        auto propertyValue = TRY(parse_expression(context, cursor));
 
-        if (!(advance(tokens, cursor, Token::Type::DOUBLE_QUOTE) || advance(tokens, cursor, Token::Type::SINGLE_QUOTE)))
+        if (!propertyValue)
         {
-            emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ peek(tokens, cursor), "was found instead of quotes" }});
+            emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ peek(context.tokens, cursor), "was found instead of a value" }});
             return make_error({});
         }
 
-        properties.emplace_back(*propertyName, std::move(*propertyValue));
+        if (!(advance(context.tokens, cursor, Token::Type::DOUBLE_QUOTE) || advance(context.tokens, cursor, Token::Type::SINGLE_QUOTE)))
+        {
+            emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ peek(context.tokens, cursor), "was found instead of quotes" }});
+            return make_error({});
+        }
+
+        properties.emplace_back(*propertyName, std::move(propertyValue));
     }
 
-    if (!advance(tokens, cursor, Token::Type::RIGHT_ANGLE))
+    if (!advance(context.tokens, cursor, Token::Type::RIGHT_ANGLE))
     {
-        emit_parser_error(ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(tokens, cursor), "was found instead of a '>'" }});
+        emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor), "was found instead of a '>'" }});
         return make_error({});
     }
 
     return std::pair { *tag, std::move(properties) };
 }
 
-static Result<void> parse_closing_tag(std::vector<Token> const& tokens, int& cursor, Token const& tag)
+static Result<void> parse_closing_tag(ParserContext& context, int& cursor, Token const& tag)
 {
-    if (!advance(tokens, cursor, Token::Type::LEFT_ANGLE))
+    if (!advance(context.tokens, cursor, Token::Type::LEFT_ANGLE))
     {
-        emit_parser_error(ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(tokens, cursor), "was found instead of a '<'" }});
+        emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor), "was found instead of a '<'" }});
         return make_error({});
     }
 
-    if (!advance(tokens, cursor, Token::Type::SLASH))
+    if (!advance(context.tokens, cursor, Token::Type::SLASH))
     {
-        emit_parser_error(ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(tokens, cursor), "was found instead of a '/'" }});
+        emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor), "was found instead of a '/'" }});
         return make_error({});
     }
 
-    if (auto closing = advance(tokens, cursor, Token::Type::KEYWORD); !closing)
+    if (auto closing = advance(context.tokens, cursor, Token::Type::KEYWORD); !closing)
     {
-        emit_parser_error(ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(tokens, cursor), "was found instead of a tag" }});
+        emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor), "was found instead of a tag" }});
         return make_error({});
     }
     else if (closing->data != tag.data)
     {
         using namespace std::literals;
 
-        emit_parser_error(ParserError::ENCLOSING_TOKEN_MISMATCH, { { tag, "this tag" }, { *closing, "does not match with this one" } });
+        emit_parser_error(context, ParserError::ENCLOSING_TOKEN_MISMATCH, { { tag, "this tag" }, { *closing, "does not match with this one" } });
 
         return make_error({});
     }
 
-    if (!advance(tokens, cursor, Token::Type::RIGHT_ANGLE))
+    if (!advance(context.tokens, cursor, Token::Type::RIGHT_ANGLE))
     {
-        emit_parser_error(ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(tokens, cursor), "was found instead of '>'" }});
+        emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor), "was found instead of '>'" }});
         return make_error({});
     }
 
     return {};
 }
 
-static Result<std::unique_ptr<Node>> parse_statement(std::vector<Token> const& tokens, int& cursor);
+// The text of a condition or of a number value, such as `${count} * 2 + 1 > 8`. Operands are integers, `true`, `false`
+// and `${name}` variables, and the operators bind the way they do in C.
+struct InfixCursor
+{
+    ParserContext& context;
+    Token const& token;
+    std::string_view text;
+    size_t offset {};
+    size_t nesting {};
+};
+
+static Result<std::unique_ptr<Node>> parse_infix_or(InfixCursor& infix);
 
-static Result<std::unique_ptr<Node>> parse_call_statement(std::vector<Token> const& tokens, int& cursor)
+static void skip_infix_spaces(InfixCursor& infix)
 {
-    auto callStmt = std::make_unique<CallStmt>();
+    while (infix.offset < infix.text.size() && infix.text[infix.offset] == ' ') infix.offset += 1;
+}
 
-    auto [tag, properties] = TRY(parse_opening_tag(tokens, cursor, "call"));
+static bool match_infix(InfixCursor& infix, std::string_view symbol)
+{
+    skip_infix_spaces(infix);
 
-    callStmt->token = tag;
+    if (!infix.text.substr(infix.offset).starts_with(symbol)) return false;
 
-    auto maybeWho = std::ranges::find_if(properties, [] (auto&& current) { return current.data == "who"; }, &decltype(properties)::value_type::first);
-    if (maybeWho == properties.end())
+    // a `!` that is really the start of `!=`.
+    if (symbol == "!" && infix.text.substr(infix.offset).starts_with("!=")) return false;
+
+    infix.offset += symbol.size();
+
+    return true;
+}
+
+static Result<std::unique_ptr<Node>> infix_error(InfixCursor& infix, std::string_view expected)
+{
+    skip_infix_spaces(infix);
+
+    auto found = infix.offset < infix.text.size() ? fmt::format("'{}'", infix.text.substr(infix.offset, 1)) : std::string("the end");
+
+    emit_parser_error(infix.context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ infix.token, fmt::format("has {} at offset {} where {} was expected", found, infix.offset, expected) }});
+
+    return make_error({});
+}
+
+static std::unique_ptr<Node> make_infix_literal(InfixCursor const& infix, std::string value)
+{
+    auto literalExpr = std::make_unique<LiteralExpr>();
+    literalExpr->token = infix.token;
+    literalExpr->value = std::move(value);
+    literalExpr->segments = split_interpolations(literalExpr->value);
+    return literalExpr;
+}
+
+template <class Expr>
+static std::unique_ptr<Node> make_infix_operation(InfixCursor const& infix, typename Expr::Operator op, std::unique_ptr<Node> lhs, std::unique_ptr<Node> rhs = {})
+{
+    auto expression = std::make_unique<Expr>();
+    expression->token = infix.token;
+    expression->op = op;
+    expression->lhs = std::move(lhs);
+    expression->rhs = std::move(rhs);
+    return expression;
+}
+
+static Result<std::unique_ptr<Node>> parse_infix_primary(InfixCursor& infix)
+{
+    skip_infix_spaces(infix);
+
+    auto rest = infix.text.substr(infix.offset);
+    auto is_name = [] (char value) { return std::isalnum(static_cast<unsigned char>(value)) || value == '_'; };
+
+    if (match_infix(infix, "("))
     {
-        emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'who'" }});
-        return make_error({});
+        auto expression = TRY(parse_infix_or(infix));
+        if (!match_infix(infix, ")")) return infix_error(infix, "a ')'");
+        return expression;
     }
-    else
+
+    if (!rest.empty() && std::isdigit(static_cast<unsigned char>(rest.front())))
     {
-        assert(maybeWho->second->node_type() == Node::Type::EXPRESSION);
-        assert(static_cast<Expression const*>(maybeWho->second.get())->expr_type() == Expression::Type::LITERAL);
-        callStmt->who = static_cast<LiteralExpr const*>(maybeWho->second.get())->value;
+        auto size = 0zu;
+        while (size < rest.size() && std::isdigit(static_cast<unsigned char>(rest[size]))) size += 1;
+
+        infix.offset += size;
+
+        return make_infix_literal(infix, std::string(rest.substr(0, size)));
     }
 
-    while (cursor > 0 && peek(tokens, cursor).depth > tag.depth)
+    if (rest.starts_with("${"))
     {
-        auto argument = parse_arg_expression(tokens, cursor);
+        auto size = 2zu;
+        while (size < rest.size() && is_name(rest[size])) size += 1;
 
-        if (argument.has_value() && argument.value())
+        if (size == rest.size() || rest[size] != '}') return infix_error(infix, "a '${name}' variable");
+
+        infix.offset += size + 1;
+
+        return make_infix_literal(infix, std::string(rest.substr(0, size + 1)));
+    }
+
+    for (auto [name, value] : { std::pair { "true", "1" }, std::pair { "false", "0" } })
+    {
+        if (rest.starts_with(name) && (rest.size() == std::strlen(name) || !is_name(rest[std::strlen(name)])))
         {
-            callStmt->arguments.push_back(std::move(argument.value()));
-            continue;
+            infix.offset += std::strlen(name);
+            return make_infix_literal(infix, value);
         }
+    }
 
-        if (!argument.has_value())
+    return infix_error(infix, "an operand");
+}
+
+static Result<std::unique_ptr<Node>> parse_infix_unary(InfixCursor& infix);
+
+static Result<std::unique_ptr<Node>> parse_infix_prefixed(InfixCursor& infix)
+{
+    if (match_infix(infix, "!"))
+    {
+        return make_infix_operation<LogicalExpr>(infix, LogicalExpr::Operator::NOT, TRY(parse_infix_unary(infix)));
+    }
+
+    if (match_infix(infix, "-"))
+    {
+        return make_infix_operation<ArithmeticExpr>(infix, ArithmeticExpr::Operator::NEGATE, TRY(parse_infix_unary(infix)));
+    }
+
+    return parse_infix_primary(infix);
+}
+
+// every operand, parenthesized or not, starts here, so this is where the nesting is counted.
+static Result<std::unique_ptr<Node>> parse_infix_unary(InfixCursor& infix)
+{
+    if (infix.nesting == MAX_INFIX_NESTING)
+    {
+        return infix_error(infix, fmt::format("an expression nested at most {} deep", MAX_INFIX_NESTING));
+    }
+
+    infix.nesting += 1;
+    auto expression = parse_infix_prefixed(infix);
+    infix.nesting -= 1;
+
+    return expression;
+}
+
+static Result<std::unique_ptr<Node>> parse_infix_term(InfixCursor& infix)
+{
+    auto lhs = TRY(parse_infix_unary(infix));
+
+    while (true)
+    {
+        if (match_infix(infix, "*")) lhs = make_infix_operation<ArithmeticExpr>(infix, ArithmeticExpr::Operator::MULTIPLY, std::move(lhs), TRY(parse_infix_unary(infix)));
+        else if (match_infix(infix, "/")) lhs = make_infix_operation<ArithmeticExpr>(infix, ArithmeticExpr::Operator::DIVIDE, std::move(lhs), TRY(parse_infix_unary(infix)));
+        else if (match_infix(infix, "%")) lhs = make_infix_operation<ArithmeticExpr>(infix, ArithmeticExpr::Operator::MODULO, std::move(lhs), TRY(parse_infix_unary(infix)));
+        else return lhs;
+    }
+}
+
+static Result<std::unique_ptr<Node>> parse_infix_sum(InfixCursor& infix)
+{
+    auto lhs = TRY(parse_infix_term(infix));
+
+    while (true)
+    {
+        if (match_infix(infix, "+")) lhs = make_infix_operation<ArithmeticExpr>(infix, ArithmeticExpr::Operator::ADD, std::move(lhs), TRY(parse_infix_term(infix)));
+        else if (match_infix(infix, "-")) lhs = make_infix_operation<ArithmeticExpr>(infix, ArithmeticExpr::Operator::SUBTRACT, std::move(lhs), TRY(parse_infix_term(infix)));
+        else return lhs;
+    }
+}
+
+static Result<std::unique_ptr<Node>> parse_infix_comparison(InfixCursor& infix)
+{
+    static constexpr std::array COMPARISONS {
+        std::pair { "==", LogicalExpr::Operator::EQUAL },
+        std::pair { "!=", LogicalExpr::Operator::NOT_EQUAL },
+        std::pair { "<=", LogicalExpr::Operator::LESS_EQUAL },
+        std::pair { ">=", LogicalExpr::Operator::GREATER_EQUAL },
+        std::pair { "<", LogicalExpr::Operator::LESS },
+        std::pair { ">", LogicalExpr::Operator::GREATER },
+    };
+
+    auto lhs = TRY(parse_infix_sum(infix));
+
+    for (auto [symbol, op] : COMPARISONS)
+    {
+        if (match_infix(infix, symbol))
         {
-            synchronize(tokens, tag, cursor);
-            continue;
+            return make_infix_operation<LogicalExpr>(infix, op, std::move(lhs), TRY(parse_infix_sum(infix)));
         }
+    }
 
-        break;
+    return lhs;
+}
+
+static Result<std::unique_ptr<Node>> parse_infix_and(InfixCursor& infix)
+{
+    auto lhs = TRY(parse_infix_comparison(infix));
+
+    while (match_infix(infix, "&&"))
+    {
+        lhs = make_infix_operation<LogicalExpr>(infix, LogicalExpr::Operator::AND, std::move(lhs), TRY(parse_infix_comparison(infix)));
     }
 
-    TRY(parse_closing_tag(tokens, cursor, tag));
+    return lhs;
+}
 
-    return callStmt;
+static Result<std::unique_ptr<Node>> parse_infix_or(InfixCursor& infix)
+{
+    auto lhs = TRY(parse_infix_and(infix));
+
+    while (match_infix(infix, "||"))
+    {
+        lhs = make_infix_operation<LogicalExpr>(infix, LogicalExpr::Operator::OR, std::move(lhs), TRY(parse_infix_and(infix)));
+    }
+
+    return lhs;
 }
 
-static Result<std::unique_ptr<Node>> parse_let_statement(std::vector<Token> const& tokens, int& cursor)
+// `literal` has to be a literal expression, which is replaced by the tree of the expression written in its text.
+static Result<std::unique_ptr<Node>> parse_infix(ParserContext& context, std::unique_ptr<Node> literal)
+{
+    auto const* literalExpr = static_cast<LiteralExpr const*>(literal.get());
+
+    // a lone number or variable is by far the common case, and is already what the parser produced.
+    if (std::ranges::all_of(literalExpr->value, ::isdigit) || (literalExpr->segments.size() == 1 && literalExpr->segments.front().kind == Segment::Kind::VARIABLE))
+    {
+        return literal;
+    }
+
+    InfixCursor infix { .context = context, .token = literalExpr->token, .text = literalExpr->value };
+
+    auto expression = TRY(parse_infix_or(infix));
+
+    skip_infix_spaces(infix);
+
+    if (infix.offset != infix.text.size()) return infix_error(infix, "an operator");
+
+    return expression;
+}
+
+static Result<std::unique_ptr<Node>> parse_statement(ParserContext& context, int& cursor);
+
+static Result<std::unique_ptr<Node>> parse_call_statement(ParserContext& context, int& cursor)
+{
+    auto callExpr = TRY(parse_call_expression(context, cursor));
+    static_cast<CallExpr*>(callExpr.get())->discarded = true;
+    return callExpr;
+}
+
+static Result<std::unique_ptr<Node>> parse_let_statement(ParserContext& context, int& cursor)
 {
     auto letStmt = std::make_unique<LetStmt>();
 
-    auto [tag, properties] = TRY(parse_opening_tag(tokens, cursor, "let"));
+    auto [tag, properties] = TRY(parse_opening_tag(context, cursor, "let"));
 
     letStmt->token = tag;
 
     auto maybeName = std::ranges::find_if(properties, [] (auto&& current) { return current.data == "name"; }, &decltype(properties)::value_type::first);
     if (maybeName == properties.end())
     {
-        emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'name'" }});
+        emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'name'" }});
         return make_error({});
     }
     else
@@ -510,7 +650,7 @@ static Result<std::unique_ptr<Node>> parse_let_statement(std::vector<Token> cons
     auto maybeType = std::ranges::find_if(properties, [] (auto&& current) { return current.data == "type"; }, &decltype(properties)::value_type::first);
     if (maybeType == properties.end())
     {
-        emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'type'" }});
+        emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'type'" }});
         return make_error({});
     }
     else
@@ -520,28 +660,44 @@ static Result<std::unique_ptr<Node>> parse_let_statement(std::vector<Token> cons
         letStmt->type = static_cast<LiteralExpr const*>(maybeType->second.get())->value;
     }
 
-    auto value = TRY(parse_expression(tokens, cursor));
+    auto maybeValue = std::ranges::find_if(properties, [] (auto&& current) { return current.data == "value"; }, &decltype(properties)::value_type::first);
+    if (maybeValue != properties.end())
+    {
+        assert(maybeValue->second->node_type() == Node::Type::EXPRESSION);
+        assert(static_cast<Expression const*>(maybeValue->second.get())->expr_type() == Expression::Type::LITERAL);
+        letStmt->value = std::move(maybeValue->second);
+    }
 
-    if (value)
+    if (!letStmt->value)
     {
-        letStmt->value = std::move(value);
+        auto value = TRY(parse_expression(context, cursor));
+
+        if (value)
+        {
+            letStmt->value = std::move(value);
+        }
+        else
+        {
+            emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ peek(context.tokens, cursor), "was found instead of property 'value'" }});
+            return make_error({});
+        }
     }
-    else
+
+    if (letStmt->type == "number" && static_cast<Expression const*>(letStmt->value.get())->expr_type() == Expression::Type::LITERAL)
     {
-        emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ peek(tokens, cursor), "was found instead of property 'value'" }});
-        return make_error({});
+        letStmt->value = TRY(parse_infix(context, std::move(letStmt->value)));
     }
 
-    TRY(parse_closing_tag(tokens, cursor, tag));
+    TRY(parse_closing_tag(context, cursor, tag));
 
     return letStmt;
 }
 
-static Result<std::unique_ptr<Node>> parse_ret_statement(std::vector<Token> const& tokens, int& cursor)
+static Result<std::unique_ptr<Node>> parse_ret_statement(ParserContext& context, int& cursor)
 {
     auto returnStmt = std::make_unique<RetStmt>();
 
-    auto [tag, properties] = TRY(parse_opening_tag(tokens, cursor, "return"));
+    auto [tag, properties] = TRY(parse_opening_tag(context, cursor, "return"));
 
     returnStmt->token = tag;
 
@@ -555,7 +711,7 @@ static Result<std::unique_ptr<Node>> parse_ret_statement(std::vector<Token> cons
 
     if (!returnStmt->value)
     {
-        auto value = TRY(parse_expression(tokens, cursor));
+        auto value = TRY(parse_expression(context, cursor));
 
         if (value)
         {
@@ -563,35 +719,38 @@ static Result<std::unique_ptr<Node>> parse_ret_statement(std::vector<Token> cons
         }
     }
 
-    TRY(parse_closing_tag(tokens, cursor, tag));
+    TRY(parse_closing_tag(context, cursor, tag));
 
     return returnStmt;
 }
 
-static Result<std::vector<std::unique_ptr<Node>>> parse_else_statement(std::vector<Token> const& tokens, int& cursor);
+static Result<std::vector<std::unique_ptr<Node>>> parse_else_statement(ParserContext& context, int& cursor);
 
-static Result<std::unique_ptr<Node>> parse_if_statement(std::vector<Token> const& tokens, int& cursor)
+static Result<std::unique_ptr<Node>> parse_if_statement(ParserContext& context, int& cursor)
 {
     auto ifStmt = std::make_unique<IfStmt>();
 
-    auto [tag, properties] = TRY(parse_opening_tag(tokens, cursor, "if"));
+    auto [tag, properties] = TRY(parse_opening_tag(context, cursor, "if"));
 
     ifStmt->token = tag;
 
     auto maybeCondition = std::ranges::find_if(properties, [] (auto&& current) { return current.data == "condition"; }, &decltype(properties)::value_type::first);
     if (maybeCondition == properties.end())
     {
-        emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'condition'" }});
+        emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'condition'" }});
         return make_error({});
     }
     else
     {
-        assert("UNIMPLEMENTED" && false);
+        assert(maybeCondition->second->node_type() == Node::Type::EXPRESSION);
+        assert(static_cast<Expression const*>(maybeCondition->second.get())->expr_type() == Expression::Type::LITERAL);
+        ifStmt->condition = TRY(parse_infix(context, std::move(maybeCondition->second)));
     }
 
-    while (cursor > 0 && peek(tokens, cursor).depth > tag.depth)
+    while (cursor > 0 && peek(context.tokens, cursor).depth > tag.depth && !is_closing_tag(context.tokens, cursor))
     {
-        auto node = parse_statement(tokens, cursor);
+        auto start = cursor;
+        auto node = parse_statement(context, cursor);
 
         if (node.has_value() && node.value())
         {
@@ -601,32 +760,34 @@ static Result<std::unique_ptr<Node>> parse_if_statement(std::vector<Token> const
 
         if (!node.has_value())
         {
-            synchronize(tokens, tag, cursor);
+            ifStmt->trueBranch.push_back(make_error_node(context.tokens, start));
+            synchronize(context.tokens, tag, start, cursor);
             continue;
         }
 
         break;
     }
 
-    TRY(parse_closing_tag(tokens, cursor, tag));
+    TRY(parse_closing_tag(context, cursor, tag));
 
-    if (peek(tokens, cursor, 1).type == Token::Type::KEYWORD && peek(tokens, cursor, 1).data == "else")
+    if (peek(context.tokens, cursor, 1).type == Token::Type::KEYWORD && peek(context.tokens, cursor, 1).data == "else")
     {
-        ifStmt->falseBranch = TRY(parse_else_statement(tokens, cursor));
+        ifStmt->falseBranch = TRY(parse_else_statement(context, cursor));
     }
 
     return ifStmt;
 }
 
-static Result<std::vector<std::unique_ptr<Node>>> parse_else_statement(std::vector<Token> const& tokens, int& cursor)
+static Result<std::vector<std::unique_ptr<Node>>> parse_else_statement(ParserContext& context, int& cursor)
 {
     std::vector<std::unique_ptr<Node>> nodes {};
 
-    auto [tag, _] = TRY(parse_opening_tag(tokens, cursor, "else"));
+    auto [tag, _] = TRY(parse_opening_tag(context, cursor, "else"));
 
-    while (cursor > 0 && peek(tokens, cursor).depth > tag.depth)
+    while (cursor > 0 && peek(context.tokens, cursor).depth > tag.depth && !is_closing_tag(context.tokens, cursor))
     {
-        auto node = parse_statement(tokens, cursor);
+        auto start = cursor;
+        auto node = parse_statement(context, cursor);
 
         if (node.has_value() && node.value())
         {
@@ -636,42 +797,89 @@ static Result<std::vector<std::unique_ptr<Node>>> parse_else_statement(std::vect
 
         if (!node.has_value())
         {
-            synchronize(tokens, tag, cursor);
+            nodes.push_back(make_error_node(context.tokens, start));
+            synchronize(context.tokens, tag, start, cursor);
             continue;
         }
 
         break;
     }
 
-    TRY(parse_closing_tag(tokens, cursor, tag));
+    TRY(parse_closing_tag(context, cursor, tag));
 
-    return {};
+    return nodes;
+}
+
+static Result<std::unique_ptr<Node>> parse_statement(ParserContext& context, int& cursor)
+{
+    if (peek(context.tokens, cursor, 1).data == "let") return parse_let_statement(context, cursor);
+    if (peek(context.tokens, cursor, 1).data == "call") return parse_call_statement(context, cursor);
+    if (peek(context.tokens, cursor, 1).data == "return") return parse_ret_statement(context, cursor);
+    if (peek(context.tokens, cursor, 1).data == "if") return parse_if_statement(context, cursor);
+
+    emit_parser_error(context, ParserError::UNEXPECTED_TOKEN_REACHED, {{ peek(context.tokens, cursor, 1), "was found instead of a statement" }});
+    return make_error({});
 }
 
-static Result<std::unique_ptr<Node>> parse_statement(std::vector<Token> const& tokens, int& cursor)
+static Result<std::unique_ptr<Node>> parse_declaration(ParserContext& context, int& cursor);
+
+// every return in a function body, including the ones nested in ifs.
+static void collect_returns(std::vector<std::unique_ptr<Node>> const& scope, std::vector<RetStmt*>& returns)
 {
-    if (peek(tokens, cursor, 1).data == "let") return parse_let_statement(tokens, cursor);
-    if (peek(tokens, cursor, 1).data == "call") return parse_call_statement(tokens, cursor);
-    if (peek(tokens, cursor, 1).data == "return") return parse_ret_statement(tokens, cursor);
-    if (peek(tokens, cursor, 1).data == "if") return parse_if_statement(tokens, cursor);
+    for (auto const& node : scope)
+    {
+        if (node->node_type() != Node::Type::STATEMENT) continue;
 
-    assert("UNREACHABLE" && false);
+        auto statement = static_cast<Statement*>(node.get());
+
+        switch (statement->stmt_type())
+        {
+        case Statement::Type::RETURN: returns.push_back(static_cast<RetStmt*>(statement)); break;
+        case Statement::Type::IF: {
+            auto ifStmt = static_cast<IfStmt*>(statement);
+            collect_returns(ifStmt->trueBranch, returns);
+            collect_returns(ifStmt->falseBranch, returns);
+            break;
+        }
+        case Statement::Type::LET: break;
+        }
+    }
 }
 
-static Result<std::unique_ptr<Node>> parse_declaration(std::vector<Token> const& tokens, int& cursor);
+// whether every way through `scope` ends in a return, either its own or one in each branch of an if.
+static bool always_returns(std::vector<std::unique_ptr<Node>> const& scope)
+{
+    return std::ranges::any_of(scope, [] (std::unique_ptr<Node> const& node) {
+        if (node->node_type() != Node::Type::STATEMENT) return false;
+
+        auto statement = static_cast<Statement const*>(node.get());
+
+        switch (statement->stmt_type())
+        {
+        case Statement::Type::RETURN: return true;
+        case Statement::Type::IF: {
+            auto ifStmt = static_cast<IfStmt const*>(statement);
+            return always_returns(ifStmt->trueBranch) && always_returns(ifStmt->falseBranch);
+        }
+        case Statement::Type::LET: return false;
+        }
+
+        return false;
+    });
+}
 
-static Result<std::unique_ptr<Node>> parse_function_declaration(std::vector<Token> const& tokens, int& cursor)
+static Result<std::unique_ptr<Node>> parse_function_declaration(ParserContext& context, int& cursor)
 {
     auto functionDecl = std::make_unique<FunctionDecl>();
 
-    auto [tag, properties] = TRY(parse_opening_tag(tokens, cursor, "function"));
+    auto [tag, properties] = TRY(parse_opening_tag(context, cursor, "function"));
 
     functionDecl->token = tag;
 
     auto maybeName = std::ranges::find_if(properties, [] (auto&& current) { return current.data == "name"; }, &decltype(properties)::value_type::first);
     if (maybeName == properties.end())
     {
-        emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'name'" }});
+        emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'name'" }});
         return make_error({});
     }
     else if (std::distance(properties.begin(), maybeName) != 0)
@@ -688,7 +896,7 @@ static Result<std::unique_ptr<Node>> parse_function_declaration(std::vector<Toke
     auto maybeType = std::ranges::find_if(properties, [] (auto&& current) { return current.data == "type"; }, &decltype(properties)::value_type::first);
     if (maybeType == properties.end())
     {
-        emit_parser_error(ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'type'" }});
+        emit_parser_error(context, ParserError::EXPECTED_TOKEN_MISSING, {{ tag, "requires property 'type'" }});
         return make_error({});
     }
     else if (std::distance(properties.begin(), maybeType) != 1)
@@ -709,9 +917,10 @@ static Result<std::unique_ptr<Node>> parse_function_declaration(std::vector<Toke
         functionDecl->parameters.push_back({ name.data, static_cast<LiteralExpr const*>(value.get())->value });
     }
 
-    while (cursor > 0 && peek(tokens, cursor).depth > tag.depth)
+    while (cursor > 0 && peek(context.tokens, cursor).depth > tag.depth && !is_closing_tag(context.tokens, cursor))
     {
-        auto statement = parse_statement(tokens, cursor);
+        auto start = cursor;
+        auto statement = parse_statement(context, cursor);
 
         if (statement.has_value() && statement.value())
         {
@@ -721,20 +930,15 @@ static Result<std::unique_ptr<Node>> parse_function_declaration(std::vector<Toke
 
         if (!statement.has_value())
         {
-            synchronize(tokens, tag, cursor);
+            functionDecl->scope.push_back(make_error_node(context.tokens, start));
+            synchronize(context.tokens, tag, start, cursor);
             continue;
         }
 
         break;
     }
 
-    auto maybeReturn = std::find_if(functionDecl->scope.begin(), functionDecl->scope.end(), [] (std::unique_ptr<Node> const& node) {
-        return
-            node->node_type() == Node::Type::STATEMENT &&
-            static_cast<Statement*>(node.get())->stmt_type() == Statement::Type::RETURN;
-    });
-
-    if (maybeReturn == functionDecl->scope.end())
+    if (!always_returns(functionDecl->scope))
     {
         if (functionDecl->type == "none")
         {
@@ -744,40 +948,57 @@ static Result<std::unique_ptr<Node>> parse_function_declaration(std::vector<Toke
         }
         else
         {
-            emit_parser_error(ParserError::MISSING_RETURN_STATEMENT, {{ tag, "expects a value to be returned, yet no <return> tag was found." }});
-            return make_error({});
+            emit_parser_error(context, ParserError::MISSING_RETURN_STATEMENT, {{ tag, "expects a value to be returned, yet not every path through it ends in a <return> tag." }});
         }
     }
-    else
+
+    std::vector<RetStmt*> returns {};
+    collect_returns(functionDecl->scope, returns);
+
+    for (auto returnStmt : returns)
     {
-        static_cast<RetStmt*>(maybeReturn->get())->type = functionDecl->type;
+        returnStmt->type = functionDecl->type;
+
+        if (returnStmt->type == "number" && returnStmt->value && static_cast<Expression const*>(returnStmt->value.get())->expr_type() == Expression::Type::LITERAL)
+        {
+            returnStmt->value = TRY(parse_infix(context, std::move(returnStmt->value)));
+        }
     }
 
-    TRY(parse_closing_tag(tokens, cursor, tag));
+    TRY(parse_closing_tag(context, cursor, tag));
 
     return functionDecl;
 }
 
-static Result<std::unique_ptr<Node>> parse_declaration(std::vector<Token> const& tokens, int& cursor)
+static Result<std::unique_ptr<Node>> parse_declaration(ParserContext& context, int& cursor)
 {
-    if (peek(tokens, cursor, 1).data == "function") return TRY(parse_function_declaration(tokens, cursor));
+    if (peek(context.tokens, cursor, 1).data == "function") return TRY(parse_function_declaration(context, cursor));
     return {};
 }
 
-static Result<std::unique_ptr<Node>> parse_program(std::vector<Token> const& tokens, int& cursor)
+static std::unique_ptr<Node> parse_program(ParserContext& context, int& cursor)
 {
     auto program = std::make_unique<ProgramDecl>();
 
-    auto [tag, _] = TRY(parse_opening_tag(tokens, cursor, "program"));
+    auto opening = parse_opening_tag(context, cursor, "program");
+
+    if (!opening.has_value())
+    {
+        program->scope.push_back(make_error_node(context.tokens, cursor));
+        return program;
+    }
+
+    auto [tag, _] = std::move(opening.value());
 
     program->token = tag;
 
-    while (cursor > 0 && peek(tokens, cursor).depth == tag.depth + 1)
+    while (cursor > 0 && peek(context.tokens, cursor).depth > tag.depth && !is_closing_tag(context.tokens, cursor))
     {
+        auto start = cursor;
         Result<std::unique_ptr<Node>> node;
 
-        if (is_next_declaration(tokens, cursor)) node = parse_declaration(tokens, cursor);
-        else if (is_next_statement(tokens, cursor)) node = parse_statement(tokens, cursor);
+        if (is_next_declaration(context.tokens, cursor)) node = parse_declaration(context, cursor);
+        else node = parse_statement(context, cursor);
 
         if (node.has_value() && node.value())
         {
@@ -787,7 +1008,8 @@ static Result<std::unique_ptr<Node>> parse_program(std::vector<Token> const& tok
 
         if (!node.has_value())
         {
-            synchronize(tokens, tag, cursor);
+            program->scope.push_back(make_error_node(context.tokens, start));
+            synchronize(context.tokens, tag, start, cursor);
             continue;
         }
 
@@ -803,27 +1025,78 @@ static Result<std::unique_ptr<Node>> parse_program(std::vector<Token> const& tok
 
     if (maybeMain != program->scope.end())
     {
-        auto call = std::make_unique<CallStmt>();
+        auto call = std::make_unique<CallExpr>();
+        call->token = (*maybeMain)->token;
         call->who = "main";
+        call->discarded = true;
         program->scope.push_back(std::move(call));
     }
 
-    TRY(parse_closing_tag(tokens, cursor, tag));
+    // a missing closing tag is already reported, and whatever was parsed up to it is still worth returning.
+    std::ignore = parse_closing_tag(context, cursor, tag);
 
     return program;
 }
 
-Result<std::unique_ptr<Node>> parse(std::vector<Token> const& tokens)
+std::vector<Segment> split_interpolations(std::string_view value)
 {
+    std::vector<Segment> segments {};
+
+    auto text = 0zu;
+
+    for (auto cursor = value.find("${"); cursor != std::string_view::npos; cursor = value.find("${", cursor))
+    {
+        auto end = cursor + 2;
+
+        while (end < value.size() && (std::isalnum(static_cast<unsigned char>(value[end])) || value[end] == '_'))
+        {
+            end += 1;
+        }
+
+        if (end == value.size() || value[end] != '}')
+        {
+            cursor += 1;
+            continue;
+        }
+
+        if (cursor > text) segments.push_back({ Segment::Kind::TEXT, text, cursor - text });
+        segments.push_back({ Segment::Kind::VARIABLE, cursor + 2, end - cursor - 2 });
+
+        text = cursor = end + 1;
+    }
+
+    if (segments.empty()) return segments;
+
+    if (text < value.size()) segments.push_back({ Segment::Kind::TEXT, text, value.size() - text });
+
+    return segments;
+}
+
+PartialAst parse_partial(std::vector<Token> const& tokens)
+{
+    ParserContext context { .tokens = tokens };
+
     auto cursor  = static_cast<int>(tokens.size()-1);
-    auto program = TRY(parse_program(tokens, cursor));
+    auto program = parse_program(context, cursor);
 
-    if (hadAnError_g)
+    if (context.errors > MAX_REPORTED_ERRORS)
+    {
+        std::cout << fmt::format("... and {} more error(s) that were not shown\n\n", context.errors - MAX_REPORTED_ERRORS);
+    }
+
+    return { std::move(program), context.errors };
+}
+
+Result<std::unique_ptr<Node>> parse(std::vector<Token> const& tokens)
+{
+    auto [program, errors] = parse_partial(tokens);
+
+    if (errors)
     {
         return make_error("I give up. ( ; ω ; )");
     }
 
-    return program;
+    return std::move(program);
 }
 
 nlohmann::ordered_json dump_ast(std::unique_ptr<Node> const& node)
@@ -845,19 +1118,6 @@ nlohmann::ordered_json dump_ast(std::unique_ptr<Node> const& node)
 
             switch (statement->stmt_type())
             {
-            case Statement::Type::CALL: {
-                auto callStmt = static_cast<CallStmt const*>(statement);
-
-                ast["statement"].push_back({ "who", callStmt->who });
-                ast["statement"].push_back({ "arguments", nlohmann::json::array() });
-
-                for (auto const& child : callStmt->arguments)
-                {
-                    ast["statement"]["arguments"].push_back(dump_ast(child));
-                }
-
-                break;
-            }
             case Statement::Type::RETURN: {
                 auto returnStmt = static_cast<RetStmt const*>(statement);
 
@@ -968,21 +1228,49 @@ nlohmann::ordered_json dump_ast(std::unique_ptr<Node> const& node)
                 break;
             }
             case Expression::Type::CALL: {
-                auto callStmt = static_cast<CallExpr const*>(expression);
+                auto callExpr = static_cast<CallExpr const*>(expression);
 
-                ast["expression"].push_back({ "who", callStmt->who });
+                ast["expression"].push_back({ "who", callExpr->who });
+                ast["expression"].push_back({ "discarded", callExpr->discarded });
                 ast["expression"].push_back({ "arguments", nlohmann::json::array() });
 
-                for (auto const& child : callStmt->arguments)
+                for (auto const& child : callExpr->arguments)
                 {
                     ast["expression"]["arguments"].push_back(dump_ast(child));
                 }
 
                 break;
             }
-            case Expression::Type::ARITHMETIC: assert("UNIMPLEMENTED" && false);
-            case Expression::Type::LOGICAL: assert("UNIMPLEMENTED" && false);
+            case Expression::Type::ARITHMETIC: {
+                auto arithmeticExpr = static_cast<ArithmeticExpr const*>(expression);
+
+                ast["expression"].push_back({ "op", magic_enum::enum_name(arithmeticExpr->op) });
+                ast["expression"].push_back({ "lhs", dump_ast(arithmeticExpr->lhs) });
+                if (arithmeticExpr->rhs) ast["expression"].push_back({ "rhs", dump_ast(arithmeticExpr->rhs) });
+
+                break;
             }
+            case Expression::Type::LOGICAL: {
+                auto logicalExpr = static_cast<LogicalExpr const*>(expression);
+
+                ast["expression"].push_back({ "op", magic_enum::enum_name(logicalExpr->op) });
+                ast["expression"].push_back({ "lhs", dump_ast(logicalExpr->lhs) });
+                if (logicalExpr->rhs) ast["expression"].push_back({ "rhs", dump_ast(logicalExpr->rhs) });
+
+                break;
+            }
+            }
+
+            break;
+        }
+        case Node::Type::ERROR: {
+            ast = {{
+                "error", {
+                    { "token", node->token.data },
+                    { "line", node->token.location.second.first },
+                    { "column", node->token.location.second.second }
+                }
+            }};
 
             break;
         }
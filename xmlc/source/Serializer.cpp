@@ -0,0 +1,591 @@
+#include "Serializer.hpp"
+
+#include <liberror/Try.hpp>
+#include <magic_enum/magic_enum.hpp>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace liberror;
+
+static constexpr std::array<uint8_t, 4> MAGIC { 'X', 'A', 'S', 'T' };
+static constexpr uint32_t HEADER_SIZE = 16;
+static constexpr uint32_t NULL_OFFSET = 0;
+static constexpr size_t MAX_DEPTH = 1024;
+
+struct Image
+{
+    std::vector<uint8_t> bytes {};
+    std::unordered_map<std::string, uint32_t> strings {};
+};
+
+static uint32_t node_kind(Node const* node)
+{
+    auto kind = [&] () -> uint32_t {
+        switch (node->node_type())
+        {
+        case Node::Type::DECLARATION: return uint32_t(static_cast<Declaration const*>(node)->decl_type());
+        case Node::Type::EXPRESSION: return uint32_t(static_cast<Expression const*>(node)->expr_type());
+        case Node::Type::STATEMENT: return uint32_t(static_cast<Statement const*>(node)->stmt_type());
+        case Node::Type::ERROR: return 0;
+        }
+        return 0;
+    }();
+
+    return uint32_t(node->node_type()) << 8 | kind;
+}
+
+static void write_u32(Image& image, uint32_t value)
+{
+    image.bytes.push_back(static_cast<uint8_t>((value >> 0)  & 0xFF));
+    image.bytes.push_back(static_cast<uint8_t>((value >> 8)  & 0xFF));
+    image.bytes.push_back(static_cast<uint8_t>((value >> 16) & 0xFF));
+    image.bytes.push_back(static_cast<uint8_t>((value >> 24) & 0xFF));
+}
+
+static void patch_u32(Image& image, uint32_t offset, uint32_t value)
+{
+    for (auto index = 0u; index < 4; index += 1)
+    {
+        image.bytes.at(offset + index) = static_cast<uint8_t>((value >> (8 * index)) & 0xFF);
+    }
+}
+
+static uint32_t write_string(Image& image, std::string const& value)
+{
+    if (auto interned = image.strings.find(value); interned != image.strings.end())
+    {
+        return interned->second;
+    }
+
+    auto offset = static_cast<uint32_t>(image.bytes.size());
+
+    write_u32(image, static_cast<uint32_t>(value.size()));
+    std::ranges::copy(value, std::back_inserter(image.bytes));
+    image.bytes.resize((image.bytes.size() + 3) & ~size_t(3), 0);
+
+    image.strings.insert({ value, offset });
+
+    return offset;
+}
+
+static uint32_t write_token(Image& image, Token const& token)
+{
+    auto data = write_string(image, token.data);
+    auto file = write_string(image, token.location.first.string());
+
+    auto offset = static_cast<uint32_t>(image.bytes.size());
+
+    write_u32(image, data);
+    write_u32(image, uint32_t(token.type));
+    write_u32(image, file);
+    write_u32(image, static_cast<uint32_t>(token.location.second.first));
+    write_u32(image, static_cast<uint32_t>(token.location.second.second));
+    write_u32(image, static_cast<uint32_t>(token.depth));
+
+    return offset;
+}
+
+static uint32_t write_node(Image& image, std::unique_ptr<Node> const& node);
+
+static uint32_t write_list(Image& image, std::vector<std::unique_ptr<Node>> const& nodes)
+{
+    std::vector<uint32_t> children {};
+    std::ranges::transform(nodes, std::back_inserter(children), [&] (auto&& child) { return write_node(image, child); });
+
+    auto offset = static_cast<uint32_t>(image.bytes.size());
+
+    write_u32(image, static_cast<uint32_t>(children.size()));
+    for (auto child : children) write_u32(image, child);
+
+    return offset;
+}
+
+static uint32_t write_node(Image& image, std::unique_ptr<Node> const& node)
+{
+    if (!node) return NULL_OFFSET;
+
+    std::vector<uint32_t> fields {};
+
+    switch (node->node_type())
+    {
+    case Node::Type::DECLARATION: {
+        auto declaration = static_cast<Declaration const*>(node.get());
+
+        fields.push_back(write_list(image, declaration->scope));
+
+        if (declaration->decl_type() == Declaration::Type::FUNCTION)
+        {
+            auto functionDecl = static_cast<FunctionDecl const*>(declaration);
+
+            fields.push_back(write_string(image, functionDecl->name));
+            fields.push_back(write_string(image, functionDecl->type));
+            fields.push_back(static_cast<uint32_t>(functionDecl->parameters.size()));
+
+            for (auto const& [name, type] : functionDecl->parameters)
+            {
+                fields.push_back(write_string(image, name));
+                fields.push_back(write_string(image, type));
+            }
+        }
+
+        break;
+    }
+    case Node::Type::EXPRESSION: {
+        auto expression = static_cast<Expression const*>(node.get());
+
+        switch (expression->expr_type())
+        {
+        case Expression::Type::ARG: {
+            fields.push_back(write_node(image, static_cast<ArgExpr const*>(expression)->value));
+            break;
+        }
+        case Expression::Type::ARITHMETIC: {
+            auto arithmeticExpr = static_cast<ArithmeticExpr const*>(expression);
+            fields.push_back(uint32_t(arithmeticExpr->op));
+            fields.push_back(write_node(image, arithmeticExpr->lhs));
+            fields.push_back(write_node(image, arithmeticExpr->rhs));
+            break;
+        }
+        case Expression::Type::LOGICAL: {
+            auto logicalExpr = static_cast<LogicalExpr const*>(expression);
+            fields.push_back(uint32_t(logicalExpr->op));
+            fields.push_back(write_node(image, logicalExpr->lhs));
+            fields.push_back(write_node(image, logicalExpr->rhs));
+            break;
+        }
+        case Expression::Type::CALL: {
+            auto callExpr = static_cast<CallExpr const*>(expression);
+            fields.push_back(write_string(image, callExpr->who));
+            fields.push_back(write_list(image, callExpr->arguments));
+            fields.push_back(callExpr->discarded);
+            break;
+        }
+        case Expression::Type::LITERAL: {
+            fields.push_back(write_string(image, static_cast<LiteralExpr const*>(expression)->value));
+            break;
+        }
+        }
+
+        break;
+    }
+    case Node::Type::STATEMENT: {
+        auto statement = static_cast<Statement const*>(node.get());
+
+        switch (statement->stmt_type())
+        {
+        case Statement::Type::IF: {
+            auto ifStmt = static_cast<IfStmt const*>(statement);
+            fields.push_back(write_node(image, ifStmt->condition));
+            fields.push_back(write_list(image, ifStmt->trueBranch));
+            fields.push_back(write_list(image, ifStmt->falseBranch));
+            break;
+        }
+        case Statement::Type::LET: {
+            auto letStmt = static_cast<LetStmt const*>(statement);
+            fields.push_back(write_string(image, letStmt->name));
+            fields.push_back(write_string(image, letStmt->type));
+            fields.push_back(write_node(image, letStmt->value));
+            break;
+        }
+        case Statement::Type::RETURN: {
+            auto retStmt = static_cast<RetStmt const*>(statement);
+            fields.push_back(write_string(image, retStmt->type));
+            fields.push_back(write_node(image, retStmt->value));
+            break;
+        }
+        }
+
+        break;
+    }
+    case Node::Type::ERROR: break;
+    }
+
+    auto token = write_token(image, node->token);
+    auto offset = static_cast<uint32_t>(image.bytes.size());
+
+    write_u32(image, node_kind(node.get()));
+    write_u32(image, token);
+    for (auto field : fields) write_u32(image, field);
+
+    return offset;
+}
+
+std::vector<uint8_t> serialize_ast(std::unique_ptr<Node> const& ast)
+{
+    Image image {};
+
+    std::ranges::copy(MAGIC, std::back_inserter(image.bytes));
+    write_u32(image, AST_FORMAT_VERSION);
+    write_u32(image, 0);
+    write_u32(image, 0);
+
+    auto root = write_node(image, ast);
+
+    patch_u32(image, 8, static_cast<uint32_t>(image.bytes.size()));
+    patch_u32(image, 12, root);
+
+    return image.bytes;
+}
+
+static Result<uint32_t> read_u32(std::span<uint8_t const> image, uint32_t offset)
+{
+    if (size_t(offset) + 4 > image.size())
+    {
+        return make_error("AST image is truncated at offset {}", offset);
+    }
+
+    return
+        uint32_t(image[offset + 0]) << 0  |
+        uint32_t(image[offset + 1]) << 8  |
+        uint32_t(image[offset + 2]) << 16 |
+        uint32_t(image[offset + 3]) << 24;
+}
+
+static Result<std::string> read_string(std::span<uint8_t const> image, uint32_t offset)
+{
+    auto size = TRY(read_u32(image, offset));
+
+    if (size_t(offset) + 4 + size > image.size())
+    {
+        return make_error("AST image string at offset {} overflows the image", offset);
+    }
+
+    auto data = image.subspan(offset + 4, size);
+
+    return std::string(data.begin(), data.end());
+}
+
+static Result<Token> read_token(std::span<uint8_t const> image, uint32_t offset)
+{
+    Token token {};
+
+    token.data = TRY(read_string(image, TRY(read_u32(image, offset))));
+
+    auto type = magic_enum::enum_cast<Token::Type>(static_cast<int>(TRY(read_u32(image, offset + 4))));
+    if (!type.has_value())
+    {
+        return make_error("AST image token at offset {} has an invalid type", offset);
+    }
+
+    token.type = *type;
+    token.location.first = TRY(read_string(image, TRY(read_u32(image, offset + 8))));
+    token.location.second.first = TRY(read_u32(image, offset + 12));
+    token.location.second.second = TRY(read_u32(image, offset + 16));
+    token.depth = TRY(read_u32(image, offset + 20));
+
+    return token;
+}
+
+// a tree writes every node and list once, so an image that reaches one twice could only ever expand into far more
+// nodes than it holds.
+struct Reader
+{
+    std::span<uint8_t const> image {};
+    std::vector<bool> visited {};
+};
+
+static Result<void> visit(Reader& reader, uint32_t offset)
+{
+    if (reader.visited.at(offset))
+    {
+        return make_error("AST image reaches offset {} more than once", offset);
+    }
+
+    reader.visited[offset] = true;
+
+    return {};
+}
+
+static Result<std::unique_ptr<Node>> read_node(Reader& reader, uint32_t offset, uint32_t limit, size_t depth);
+
+static bool is_node(std::unique_ptr<Node> const& node, Node::Type type)
+{
+    return node && node->node_type() == type;
+}
+
+static bool is_arg_list(std::vector<std::unique_ptr<Node>> const& nodes)
+{
+    return std::ranges::all_of(nodes, [] (auto&& node) {
+        return is_node(node, Node::Type::ERROR) ||
+               (is_node(node, Node::Type::EXPRESSION) && static_cast<Expression const*>(node.get())->expr_type() == Expression::Type::ARG);
+    });
+}
+
+static bool is_statement_list(std::vector<std::unique_ptr<Node>> const& nodes)
+{
+    return std::ranges::all_of(nodes, [] (auto&& node) {
+        return is_node(node, Node::Type::STATEMENT) || is_node(node, Node::Type::ERROR) ||
+               (is_node(node, Node::Type::EXPRESSION) && static_cast<Expression const*>(node.get())->expr_type() == Expression::Type::CALL);
+    });
+}
+
+static Result<std::vector<std::unique_ptr<Node>>> read_list(Reader& reader, uint32_t offset, uint32_t limit, size_t depth)
+{
+    if (offset >= limit)
+    {
+        return make_error("AST image list at offset {} is not ordered before its parent", offset);
+    }
+
+    TRY(visit(reader, offset));
+
+    auto image = reader.image;
+    auto count = TRY(read_u32(image, offset));
+
+    if (size_t(count) * 4 > image.size())
+    {
+        return make_error("AST image list at offset {} overflows the image", offset);
+    }
+
+    std::vector<std::unique_ptr<Node>> nodes {};
+
+    for (auto index = 0u; index < count; index += 1)
+    {
+        auto child = TRY(read_node(reader, TRY(read_u32(image, offset + 4 + index * 4)), offset, depth));
+
+        if (!child)
+        {
+            return make_error("AST image list at offset {} contains a null node", offset);
+        }
+
+        nodes.push_back(std::move(child));
+    }
+
+    return nodes;
+}
+
+// the later passes rely on the same shape guarantees the parser gives, so an image has to honour them as well.
+static bool is_well_formed(Node const* node)
+{
+    switch (node->node_type())
+    {
+    case Node::Type::DECLARATION: {
+        auto declaration = static_cast<Declaration const*>(node);
+        return declaration->decl_type() == Declaration::Type::PROGRAM || is_statement_list(declaration->scope);
+    }
+    case Node::Type::EXPRESSION: {
+        auto expression = static_cast<Expression const*>(node);
+
+        switch (expression->expr_type())
+        {
+        case Expression::Type::ARG: return is_node(static_cast<ArgExpr const*>(expression)->value, Node::Type::EXPRESSION);
+        case Expression::Type::CALL: return is_arg_list(static_cast<CallExpr const*>(expression)->arguments);
+        case Expression::Type::ARITHMETIC: {
+            auto arithmeticExpr = static_cast<ArithmeticExpr const*>(expression);
+            auto unary = arithmeticExpr->op == ArithmeticExpr::Operator::NEGATE;
+            return is_node(arithmeticExpr->lhs, Node::Type::EXPRESSION) && (unary ? !arithmeticExpr->rhs : is_node(arithmeticExpr->rhs, Node::Type::EXPRESSION));
+        }
+        case Expression::Type::LOGICAL: {
+            auto logicalExpr = static_cast<LogicalExpr const*>(expression);
+            auto unary = logicalExpr->op == LogicalExpr::Operator::NOT;
+            return is_node(logicalExpr->lhs, Node::Type::EXPRESSION) && (unary ? !logicalExpr->rhs : is_node(logicalExpr->rhs, Node::Type::EXPRESSION));
+        }
+        case Expression::Type::LITERAL: return true;
+        }
+
+        break;
+    }
+    case Node::Type::STATEMENT: {
+        auto statement = static_cast<Statement const*>(node);
+
+        switch (statement->stmt_type())
+        {
+        case Statement::Type::IF: {
+            auto ifStmt = static_cast<IfStmt const*>(statement);
+            return is_statement_list(ifStmt->trueBranch) && is_statement_list(ifStmt->falseBranch);
+        }
+        case Statement::Type::LET: return is_node(static_cast<LetStmt const*>(statement)->value, Node::Type::EXPRESSION);
+        case Statement::Type::RETURN: {
+            auto const& value = static_cast<RetStmt const*>(statement)->value;
+            return !value || is_node(value, Node::Type::EXPRESSION);
+        }
+        }
+
+        break;
+    }
+    case Node::Type::ERROR: return true;
+    }
+
+    return false;
+}
+
+static Result<std::unique_ptr<Node>> read_node(Reader& reader, uint32_t offset, uint32_t limit, size_t depth)
+{
+    if (offset == NULL_OFFSET) return nullptr;
+
+    if (offset < HEADER_SIZE || offset >= limit)
+    {
+        return make_error("AST image node at offset {} is not ordered before its parent", offset);
+    }
+
+    if (depth > MAX_DEPTH)
+    {
+        return make_error("AST image is nested deeper than {} nodes", MAX_DEPTH);
+    }
+
+    TRY(visit(reader, offset));
+
+    auto image = reader.image;
+
+    auto kind  = TRY(read_u32(image, offset));
+    auto token = TRY(read_token(image, TRY(read_u32(image, offset + 4))));
+
+    auto field = [&, cursor = offset + 8] () mutable -> Result<uint32_t> {
+        auto value = TRY(read_u32(image, cursor));
+        cursor += 4;
+        return value;
+    };
+
+    std::unique_ptr<Node> node {};
+
+    switch (kind)
+    {
+    case uint32_t(Node::Type::DECLARATION) << 8 | uint32_t(Declaration::Type::PROGRAM): {
+        auto programDecl = std::make_unique<ProgramDecl>();
+        programDecl->scope = TRY(read_list(reader, TRY(field()), offset, depth + 1));
+        node = std::move(programDecl);
+        break;
+    }
+    case uint32_t(Node::Type::DECLARATION) << 8 | uint32_t(Declaration::Type::FUNCTION): {
+        auto functionDecl = std::make_unique<FunctionDecl>();
+        functionDecl->scope = TRY(read_list(reader, TRY(field()), offset, depth + 1));
+        functionDecl->name = TRY(read_string(image, TRY(field())));
+        functionDecl->type = TRY(read_string(image, TRY(field())));
+
+        auto count = TRY(field());
+
+        for (auto index = 0u; index < count; index += 1)
+        {
+            auto name = TRY(read_string(image, TRY(field())));
+            auto type = TRY(read_string(image, TRY(field())));
+            functionDecl->parameters.push_back({ name, type });
+        }
+
+        node = std::move(functionDecl);
+        break;
+    }
+    case uint32_t(Node::Type::EXPRESSION) << 8 | uint32_t(Expression::Type::ARG): {
+        auto argExpr = std::make_unique<ArgExpr>();
+        argExpr->value = TRY(read_node(reader, TRY(field()), offset, depth + 1));
+        node = std::move(argExpr);
+        break;
+    }
+    case uint32_t(Node::Type::EXPRESSION) << 8 | uint32_t(Expression::Type::ARITHMETIC): {
+        auto arithmeticExpr = std::make_unique<ArithmeticExpr>();
+
+        auto op = magic_enum::enum_cast<ArithmeticExpr::Operator>(static_cast<int>(TRY(field())));
+        if (!op.has_value())
+        {
+            return make_error("AST image node at offset {} has an invalid operator", offset);
+        }
+
+        arithmeticExpr->op = *op;
+        arithmeticExpr->lhs = TRY(read_node(reader, TRY(field()), offset, depth + 1));
+        arithmeticExpr->rhs = TRY(read_node(reader, TRY(field()), offset, depth + 1));
+        node = std::move(arithmeticExpr);
+        break;
+    }
+    case uint32_t(Node::Type::EXPRESSION) << 8 | uint32_t(Expression::Type::LOGICAL): {
+        auto logicalExpr = std::make_unique<LogicalExpr>();
+
+        auto op = magic_enum::enum_cast<LogicalExpr::Operator>(static_cast<int>(TRY(field())));
+        if (!op.has_value())
+        {
+            return make_error("AST image node at offset {} has an invalid operator", offset);
+        }
+
+        logicalExpr->op = *op;
+        logicalExpr->lhs = TRY(read_node(reader, TRY(field()), offset, depth + 1));
+        logicalExpr->rhs = TRY(read_node(reader, TRY(field()), offset, depth + 1));
+        node = std::move(logicalExpr);
+        break;
+    }
+    case uint32_t(Node::Type::EXPRESSION) << 8 | uint32_t(Expression::Type::CALL): {
+        auto callExpr = std::make_unique<CallExpr>();
+        callExpr->who = TRY(read_string(image, TRY(field())));
+        callExpr->arguments = TRY(read_list(reader, TRY(field()), offset, depth + 1));
+        callExpr->discarded = TRY(field()) != 0;
+        node = std::move(callExpr);
+        break;
+    }
+    case uint32_t(Node::Type::EXPRESSION) << 8 | uint32_t(Expression::Type::LITERAL): {
+        auto literalExpr = std::make_unique<LiteralExpr>();
+        literalExpr->value = TRY(read_string(image, TRY(field())));
+        literalExpr->segments = split_interpolations(literalExpr->value);
+        node = std::move(literalExpr);
+        break;
+    }
+    case uint32_t(Node::Type::STATEMENT) << 8 | uint32_t(Statement::Type::IF): {
+        auto ifStmt = std::make_unique<IfStmt>();
+        ifStmt->condition = TRY(read_node(reader, TRY(field()), offset, depth + 1));
+        ifStmt->trueBranch = TRY(read_list(reader, TRY(field()), offset, depth + 1));
+        ifStmt->falseBranch = TRY(read_list(reader, TRY(field()), offset, depth + 1));
+        node = std::move(ifStmt);
+        break;
+    }
+    case uint32_t(Node::Type::STATEMENT) << 8 | uint32_t(Statement::Type::LET): {
+        auto letStmt = std::make_unique<LetStmt>();
+        letStmt->name = TRY(read_string(image, TRY(field())));
+        letStmt->type = TRY(read_string(image, TRY(field())));
+        letStmt->value = TRY(read_node(reader, TRY(field()), offset, depth + 1));
+        node = std::move(letStmt);
+        break;
+    }
+    case uint32_t(Node::Type::STATEMENT) << 8 | uint32_t(Statement::Type::RETURN): {
+        auto retStmt = std::make_unique<RetStmt>();
+        retStmt->type = TRY(read_string(image, TRY(field())));
+        retStmt->value = TRY(read_node(reader, TRY(field()), offset, depth + 1));
+        node = std::move(retStmt);
+        break;
+    }
+    case uint32_t(Node::Type::ERROR) << 8: {
+        node = std::make_unique<ErrorNode>();
+        break;
+    }
+    default: {
+        return make_error("AST image node at offset {} has an unknown kind {:#x}", offset, kind);
+    }
+    }
+
+    if (!is_well_formed(node.get()))
+    {
+        return make_error("AST image node at offset {} is malformed", offset);
+    }
+
+    node->token = std::move(token);
+
+    return node;
+}
+
+Result<std::unique_ptr<Node>> deserialize_ast(std::span<uint8_t const> image)
+{
+    if (image.size() < HEADER_SIZE || !std::equal(MAGIC.begin(), MAGIC.end(), image.begin()))
+    {
+        return make_error("AST image has an invalid header");
+    }
+
+    if (auto version = TRY(read_u32(image, 4)); version != AST_FORMAT_VERSION)
+    {
+        return make_error("AST image version {} does not match the expected version {}", version, AST_FORMAT_VERSION);
+    }
+
+    if (auto size = TRY(read_u32(image, 8)); size != image.size())
+    {
+        return make_error("AST image size {} does not match the buffer size {}", size, image.size());
+    }
+
+    auto root = TRY(read_u32(image, 12));
+    Reader reader { .image = image, .visited = std::vector<bool>(image.size()) };
+
+    auto ast = TRY(read_node(reader, root, static_cast<uint32_t>(image.size()), 0));
+
+    if (!ast || ast->node_type() != Node::Type::DECLARATION || static_cast<Declaration const*>(ast.get())->decl_type() != Declaration::Type::PROGRAM)
+    {
+        return make_error("AST image root is not a program");
+    }
+
+    return ast;
+}
@@ -0,0 +1,156 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+static bool run_one(ThreadPool& pool, size_t first)
+{
+    for (auto offset = 0zu; offset < pool.queues.size(); offset += 1)
+    {
+        auto& queue = *pool.queues[(first + offset) % pool.queues.size()];
+        std::function<void()> job {};
+
+        {
+            std::scoped_lock lock(queue.mutex);
+
+            if (queue.jobs.empty()) continue;
+
+            // the owner works from the back, which is what it pushed last and is the most likely to still be cached.
+            if (offset == 0)
+            {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+            }
+            else
+            {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+            }
+        }
+
+        {
+            std::scoped_lock lock(pool.mutex);
+            pool.pending -= 1;
+        }
+
+        job();
+
+        return true;
+    }
+
+    return false;
+}
+
+static void work(ThreadPool& pool, size_t worker)
+{
+    while (true)
+    {
+        if (run_one(pool, worker)) continue;
+
+        std::unique_lock lock(pool.mutex);
+        pool.wakeup.wait(lock, [&] { return pool.stopping || pool.pending > 0; });
+
+        if (pool.stopping && pool.pending == 0) return;
+    }
+}
+
+ThreadPool::ThreadPool(size_t count)
+{
+    for (auto worker = 0zu; worker < count; worker += 1)
+    {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (auto worker = 0zu; worker < count; worker += 1)
+    {
+        workers.emplace_back([this, worker] { work(*this, worker); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::scoped_lock lock(mutex);
+        stopping = true;
+    }
+
+    wakeup.notify_all();
+
+    for (auto& worker : workers) worker.join();
+}
+
+void parallel_for(ThreadPool& pool, size_t count, std::function<void(size_t)> const& job)
+{
+    if (pool.queues.empty() || count < 2)
+    {
+        for (auto index = 0zu; index < count; index += 1) job(index);
+        return;
+    }
+
+    // a few chunks per worker is enough for stealing to balance them, without paying for one job per index.
+    auto chunkSize = (count + pool.queues.size() * 4 - 1) / (pool.queues.size() * 4);
+    auto chunks = (count + chunkSize - 1) / chunkSize;
+
+    // only ever touched under `doneMutex`, otherwise the last chunk could still be notifying after this call returned.
+    auto remaining = chunks;
+    std::mutex doneMutex {};
+    std::condition_variable done {};
+
+    size_t first {};
+
+    {
+        std::scoped_lock lock(pool.mutex);
+        first = pool.next;
+        pool.next += chunks;
+        pool.pending += chunks;
+    }
+
+    for (auto chunk = 0zu; chunk < chunks; chunk += 1)
+    {
+        auto begin = chunk * chunkSize;
+        auto end = std::min(count, begin + chunkSize);
+
+        auto& queue = *pool.queues[(first + chunk) % pool.queues.size()];
+
+        std::scoped_lock lock(queue.mutex);
+
+        queue.jobs.push_back([&, begin, end] {
+            for (auto index = begin; index < end; index += 1) job(index);
+
+            std::scoped_lock doneLock(doneMutex);
+            if (--remaining == 0) done.notify_all();
+        });
+    }
+
+    pool.wakeup.notify_all();
+
+    while (run_one(pool, first % pool.queues.size())) {}
+
+    // the queues are empty, so everything left of this call is already running somewhere else.
+    std::unique_lock lock(doneMutex);
+    done.wait(lock, [&] { return remaining == 0; });
+}
+
+static size_t configured_jobs()
+{
+    if (auto jobs = std::getenv("XMLC_JOBS"))
+    {
+        size_t count {};
+
+        if (auto [end, error] = std::from_chars(jobs, jobs + std::strlen(jobs), count); error == std::errc {} && count > 0)
+        {
+            return count;
+        }
+    }
+
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+ThreadPool& shared_thread_pool()
+{
+    // the calling thread always works alongside the pool, so one less worker keeps the total at the configured count.
+    static ThreadPool pool(configured_jobs() - 1);
+    return pool;
+}
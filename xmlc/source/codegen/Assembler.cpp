@@ -1,39 +1,26 @@
 #include "codegen/Assembler.hpp"
-
-#include <libcoro/Generator.hpp>
-#include <liberror/Try.hpp>
-#include <magic_enum/magic_enum.hpp>
+#include "codegen/Superinstructions.hpp"
+#include "Intrinsics.hpp"
+#include "ThreadPool.hpp"
 
 #include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdint>
-#include <cstring>
 #include <functional>
-#include <regex>
+#include <numeric>
+#include <optional>
 #include <span>
-#include <sstream>
-#include <string>
+#include <string_view>
 
 using namespace liberror;
-using namespace libcoro;
-
-enum class Opcode
-{
-    CALL,
-    LOAD,
-    POP,
-    PUSH,
-    RET,
-    STORE
-};
-
-enum class CallMode { EXTRINSIC, INTRINSIC };
 
-enum class Intrinsic { PRINT, PRINTLN };
+// below this many functions, handing them out to other threads costs more than encoding them.
+static constexpr size_t PARALLEL_FUNCTIONS_THRESHOLD = 64;
 
-enum class DataSource { DATA_SEGMENT, LOCAL_SCOPE, GLOBAL_SCOPE };
-enum class DataDestination { LOCAL_SCOPE, GLOBAL_SCOPE };
+static constexpr std::string_view MAGIC = "This is a kubo program";
+// the magic, then where the data segment, the code segment and the entrypoint start.
+static constexpr size_t HEADER_SIZE = MAGIC.size() + 3 * 4;
 
 inline std::array<uint8_t, 4> int_2_bytes(int value)
 {
@@ -45,236 +32,329 @@ inline std::array<uint8_t, 4> int_2_bytes(int value)
     };
 }
 
-static std::map<std::string, int32_t> codeSegmentOffsets_g;
+// The part of the program one function, or the data segment, was given to write into.
+struct Output
+{
+    std::span<uint8_t> bytes;
+    size_t size {};
+};
+
+static void write_byte(Output& output, uint8_t value)
+{
+    output.bytes[output.size++] = value;
+}
 
-static Generator<std::string> next_line(std::string_view code)
+static void write_int(Output& output, int32_t value)
 {
-    std::istringstream stream(code.data());
+    std::ranges::copy(int_2_bytes(value), output.bytes.begin() + ptrdiff_t(output.size));
+    output.size += 4;
+}
 
-    for (std::string line; std::getline(stream, line); )
+static void write_data_segment(Module const& module, Output& output)
+{
+    for (auto const& entry : module.constants.entries)
     {
-        co_yield line;
+        write_int(output, static_cast<int32_t>(entry.size()));
+        std::ranges::copy(entry, output.bytes.begin() + ptrdiff_t(output.size));
+        output.size += entry.size();
     }
+}
+
+struct AssemblerContext
+{
+    Module const& module;
+    // where each function starts, in the same order as the module's, and then the entrypoint.
+    std::vector<size_t> offsets {};
+};
+
+// CALL, LOAD, STORE, PUSH and ENTER keep their mode in the two lowest bits, and set this one when their operand takes
+// 4 bytes instead of 1.
+static constexpr uint8_t WIDE_OPERAND = 0b100;
 
-    co_return;
+static uint8_t encode_opcode(Opcode opcode, uint8_t mode = 0)
+{
+    return uint8_t(uint8_t(opcode) << 3 | mode);
 }
 
-static Result<std::vector<uint8_t>> assemble_data_segment(std::string_view code)
+// PUSH sign extends its one byte operand, the others are never negative.
+static bool fits_in_byte(Opcode opcode, int32_t operand)
 {
-    if (code.empty()) return {};
+    if (opcode == Opcode::PUSH) return operand >= INT8_MIN && operand <= INT8_MAX;
+    return operand >= 0 && operand <= UINT8_MAX;
+}
 
-    std::vector<uint8_t> bytes {};
+// where the callee starts.
+static int32_t call_target(AssemblerContext const& context, Instruction const& instruction)
+{
+    if (!is_extrinsic_call(instruction)) return int32_t(INTRINSICS.at(size_t(instruction.operand)).id);
+    return int32_t(context.offsets.at(size_t(instruction.operand)));
+}
 
-    auto reader = next_line(code);
+// the operand that ends up in the bytecode, which for calls is where the callee starts.
+static int32_t encoded_operand(AssemblerContext const& context, Instruction const& instruction)
+{
+    if (instruction.opcode == Opcode::CALL) return call_target(context, instruction);
+    return instruction.operand;
+}
 
-    if (auto segment = reader.next(); segment != ".data")
+// how many bytes the operand takes, leaving out the opcode in front of it.
+static size_t operand_size(AssemblerContext const& context, Instruction const& instruction)
+{
+    if (!has_variable_operand(instruction.opcode)) return 0;
+    return fits_in_byte(instruction.opcode, encoded_operand(context, instruction)) ? 1 : 4;
+}
+
+// whether the instruction at `index` and the one after it are encoded together, as the superinstruction returned.
+static std::optional<size_t> superinstruction_at(Function const& function, size_t index)
+{
+    if (index + 1 >= function.code.size()) return std::nullopt;
+    return find_superinstruction(function.code[index], function.code[index + 1]);
+}
+
+static size_t instruction_size(AssemblerContext const& context, Function const& function, Instruction const& instruction)
+{
+    switch (instruction.opcode)
     {
-        return make_error("Unexpected segment '{}' was reached", segment);
+    case Opcode::CALL:
+    case Opcode::LOAD:
+    case Opcode::STORE:
+    case Opcode::ENTER:
+    case Opcode::PUSH: return 1 + operand_size(context, instruction);
+    case Opcode::JUMP: return 5;
+    case Opcode::JUMP_TABLE: return 13 + 4 * function.tables.at(size_t(instruction.operand)).labels.size();
+    case Opcode::COMPARE:
+    case Opcode::EQUALS:
+    case Opcode::ARITHMETIC:
+    case Opcode::POP:
+    case Opcode::RET: return 1;
+    case Opcode::LABEL: return 0;
     }
 
-    reader.next();
+    return 0;
+}
+
+// how many bytes the function takes once encoded at `start`, noting where each of its labels lands on the way when
+// `labels` has room for them. jumps refer to labels, which are only known once every instruction before them has a size.
+static size_t measure_function(AssemblerContext const& context, Function const& function, size_t start, std::span<size_t> labels = {})
+{
+    auto offset = start;
 
-    for (auto entry : reader)
+    for (auto index = 0zu; index < function.code.size(); index += 1)
     {
-        int size;
-        std::stringstream(entry.substr(0, entry.find_first_of(' '))) >> size;
-        std::ranges::copy(int_2_bytes(size), std::back_inserter(bytes));
-        std::ranges::transform(entry.substr(entry.find_first_of(' ')+1), std::back_inserter(bytes), std::identity{});
+        auto const& instruction = function.code[index];
+
+        if (instruction.opcode == Opcode::LABEL && !labels.empty()) labels[size_t(instruction.operand)] = offset;
+
+        if (superinstruction_at(function, index))
+        {
+            offset += 1 + operand_size(context, instruction) + operand_size(context, function.code[index + 1]);
+            index += 1;
+            continue;
+        }
+
+        offset += instruction_size(context, function, instruction);
     }
 
-    return bytes;
+    return offset - start;
 }
 
-static std::array<uint8_t, 2> assemble_call(std::string const& operand)
+static void for_each_function(size_t count, std::function<void(size_t)> const& job)
 {
-    if (codeSegmentOffsets_g.contains(operand))
+    if (count < PARALLEL_FUNCTIONS_THRESHOLD)
     {
-        return {
-            uint8_t(Opcode::CALL) << 3 | uint8_t(CallMode::EXTRINSIC),
-            uint8_t(codeSegmentOffsets_g.at(operand))
-        };
+        for (auto index = 0zu; index < count; index += 1) job(index);
     }
     else
     {
-        std::string intrinsic {};
-        std::transform(operand.begin(), operand.end(), std::back_inserter(intrinsic), ::toupper);
-
-        assert(magic_enum::enum_contains<Intrinsic>(intrinsic));
-
-        return {
-            uint8_t(Opcode::CALL) << 3 | uint8_t(CallMode::INTRINSIC),
-            uint8_t(*magic_enum::enum_cast<Intrinsic>(intrinsic))
-        };
+        parallel_for(shared_thread_pool(), count, job);
     }
 }
 
-static std::array<uint8_t, 6> assemble_load(std::string const& operands)
+// How big a function is depends on which of its calls reach their callee with a 1 byte target, and so on the size of
+// every function placed before that callee. Starting out with every call wide, a pass can only ever shrink functions and
+// move callees closer to the start, so the offsets settle once a pass leaves them as they were. Returns the sizes.
+static std::vector<size_t> lay_out_functions(AssemblerContext& context, std::span<Function const* const> functions)
 {
-    int offset;
-    auto offsetData = operands.substr(operands.find_first_of('[')+1);
-    offsetData.pop_back();
-    std::stringstream(offsetData) >> offset;
-
-    auto source = [&] {
-        std::string source;
-        std::stringstream(operands.substr(0, operands.find_first_of('['))) >> source;
-        return
-            source == ".data" ? DataSource::DATA_SEGMENT :
-            source == "scope" ? DataSource::LOCAL_SCOPE  :
-                                DataSource::GLOBAL_SCOPE;
-    }();
-
-    std::array<uint8_t, 6> result {
-        uint8_t(Opcode::LOAD) << 3,
-        uint8_t(source)
-    };
+    std::vector<size_t> wideSizes(functions.size());
 
-    std::ranges::copy(int_2_bytes(offset), std::next(std::begin(result), 2));
+    // past what a byte holds, so that every call is measured as wide.
+    context.offsets.assign(functions.size(), UINT8_MAX + 1);
 
-    return result;
-}
+    // the only pass that goes over every instruction, the ones after it only look at the calls.
+    for_each_function(functions.size(), [&] (size_t index) {
+        wideSizes[index] = measure_function(context, *functions[index], 0);
+    });
 
-static std::array<uint8_t, 1> assemble_pop()
-{
-    return { uint8_t(Opcode::POP) << 3 };
-}
+    // the caller and the callee of every call to another function.
+    std::vector<std::pair<size_t, size_t>> calls {};
 
-static std::array<uint8_t, 5> assemble_push(std::string const& operand)
-{
-    int value;
-    std::stringstream(operand) >> value;
+    for (auto index = 0zu; index < functions.size(); index += 1)
+    {
+        for (auto const& instruction : functions[index]->code)
+        {
+            if (is_extrinsic_call(instruction)) calls.emplace_back(index, size_t(instruction.operand));
+        }
+    }
 
-    std::array<uint8_t, 5> result {
-        uint8_t(Opcode::PUSH) << 3,
-    };
+    std::vector<size_t> sizes(functions.size());
+
+    while (true)
+    {
+        sizes = wideSizes;
+
+        // a 1 byte target saves 3 of the 4 bytes.
+        for (auto [caller, callee] : calls)
+        {
+            if (context.offsets[callee] <= UINT8_MAX) sizes[caller] -= 3;
+        }
+
+        std::vector<size_t> offsets(functions.size());
+        std::exclusive_scan(sizes.begin(), sizes.end(), offsets.begin(), 0zu);
 
-    std::ranges::copy(int_2_bytes(value), std::next(std::begin(result), 1));
+        if (offsets == context.offsets) return sizes;
 
-    return result;
+        context.offsets = std::move(offsets);
+    }
 }
 
-static std::array<uint8_t, 1> assemble_ret()
+// the shortest form that holds the operand, big endian when it needs all 4 bytes. returns whether it did.
+static bool write_operand(AssemblerContext const& context, Output& output, Instruction const& instruction)
 {
-    return { uint8_t(Opcode::RET) << 3 };
+    auto operand = encoded_operand(context, instruction);
+
+    if (fits_in_byte(instruction.opcode, operand))
+    {
+        write_byte(output, uint8_t(operand));
+        return false;
+    }
+
+    write_int(output, operand);
+
+    return true;
 }
 
-static std::array<uint8_t, 6> assemble_store(std::string const& operands)
+static void assemble_operand(AssemblerContext const& context, Output& output, Instruction const& instruction)
 {
-    int offset;
-    std::stringstream(operands.substr(operands.find_first_of('[')+1, 1)) >> offset;
-
-    auto destination = [&] {
-        std::string destination;
-        std::stringstream(operands.substr(0, operands.find_first_of('['))) >> destination;
-        return
-            destination == "scope" ? DataDestination::LOCAL_SCOPE  :
-                                     DataDestination::GLOBAL_SCOPE;
-    }();
-
-    std::array<uint8_t, 6> result {
-        uint8_t(Opcode::STORE) << 3,
-        uint8_t(destination)
-    };
+    auto start = output.size;
 
-    std::ranges::copy(int_2_bytes(offset), std::next(std::begin(result), 2));
+    write_byte(output, encode_opcode(instruction.opcode, instruction.mode));
 
-    return result;
+    if (write_operand(context, output, instruction)) output.bytes[start] |= WIDE_OPERAND;
 }
 
-static Result<std::vector<uint8_t>> assemble_code_segment(std::string_view code)
+// one opcode for both instructions, followed by whichever of their operands they have.
+static void assemble_superinstruction(AssemblerContext const& context, Output& output, size_t superinstruction, std::span<Instruction const, 2> parts)
 {
-    std::vector<uint8_t> bytes {};
+    auto start = output.size;
 
-    auto reader = next_line(code);
+    write_byte(output, uint8_t((FIRST_SUPERINSTRUCTION + superinstruction) << 3));
 
-    if (auto segment = reader.next(); segment != ".code")
+    for (auto index = 0zu; index < parts.size(); index += 1)
     {
-        return make_error("Unexpected segment '{}' was reached", segment);
+        if (!has_variable_operand(parts[index].opcode)) continue;
+        if (write_operand(context, output, parts[index])) output.bytes[start] |= uint8_t(1 << index);
     }
+}
 
-    reader.next();
+// `output` is exactly as big as the function, which starts at `start` in the code segment.
+static void assemble_function(AssemblerContext const& context, Output& output, Function const& function, size_t start)
+{
+    std::vector<size_t> labels(function.labels);
+    if (!labels.empty()) measure_function(context, function, start, labels);
 
-    for (auto header : reader)
+    for (auto index = 0zu; index < function.code.size(); index += 1)
     {
-        assert(header.starts_with("function") || header.starts_with("entrypoint"));
+        auto const& instruction = function.code[index];
 
-        codeSegmentOffsets_g.insert({ header.starts_with("function") ? header.substr(header.find_first_of(' ')+1) : "entrypoint", bytes.size() });
-
-        reader.next();
+        if (auto superinstruction = superinstruction_at(function, index))
+        {
+            assemble_superinstruction(context, output, *superinstruction, std::span(function.code).subspan(index).first<2>());
+            index += 1;
+            continue;
+        }
 
-        for (auto instruction : reader)
+        switch (instruction.opcode)
         {
-            if (instruction.empty()) break;
+        case Opcode::CALL:
+        case Opcode::LOAD:
+        case Opcode::STORE:
+        case Opcode::ENTER:
+        case Opcode::PUSH: {
+            assemble_operand(context, output, instruction);
+            break;
+        }
+        case Opcode::JUMP: {
+            write_byte(output, encode_opcode(instruction.opcode, instruction.mode));
+            write_int(output, int32_t(labels.at(size_t(instruction.operand))));
+            break;
+        }
+        case Opcode::JUMP_TABLE: {
+            auto const& table = function.tables.at(size_t(instruction.operand));
 
-            auto opcode = instruction.substr(0, instruction.find_first_of(' '));
+            write_byte(output, encode_opcode(instruction.opcode));
+            write_int(output, table.low);
+            write_int(output, int32_t(table.labels.size()));
+            write_int(output, int32_t(labels.at(size_t(table.fallback))));
 
-            if (!(opcode == "pop" || opcode == "ret"))
-            {
-                auto operands = instruction.substr(instruction.find_first_of(' ') + 1);
-
-                if      (opcode == "call") std::ranges::copy(assemble_call(operands), std::back_inserter(bytes));
-                else if (opcode == "load") std::ranges::copy(assemble_load(operands), std::back_inserter(bytes));
-                else if (opcode == "push") std::ranges::copy(assemble_push(operands), std::back_inserter(bytes));
-                else if (opcode == "store") std::ranges::copy(assemble_store(operands), std::back_inserter(bytes));
-                else
-                {
-                    return make_error("Unknown instruction '{}' was reached", instruction);
-                }
-            }
-            else if (opcode == "pop")
-            {
-                std::ranges::copy(assemble_pop(), std::back_inserter(bytes));
-            }
-            else if (opcode == "ret")
+            for (auto label : table.labels)
             {
-                std::ranges::copy(assemble_ret(), std::back_inserter(bytes));
+                write_int(output, int32_t(labels.at(size_t(label))));
             }
+
+            break;
+        }
+        case Opcode::COMPARE:
+        case Opcode::EQUALS:
+        case Opcode::ARITHMETIC: {
+            write_byte(output, encode_opcode(instruction.opcode, instruction.mode));
+            break;
+        }
+        case Opcode::POP:
+        case Opcode::RET: {
+            write_byte(output, encode_opcode(instruction.opcode));
+            break;
+        }
+        case Opcode::LABEL: break;
         }
     }
-
-    return bytes;
 }
 
-Result<std::vector<uint8_t>> assemble(std::string const& code)
+Result<std::vector<uint8_t>> assemble(Module const& module)
 {
-    std::stringstream stream(code);
+    // the entrypoint goes last, after every function.
+    std::vector<Function const*> functions {};
+    functions.reserve(module.functions.size() + 1);
 
-    std::string dataSegment;
-    std::string codeSegment;
+    for (auto const& function : module.functions) functions.push_back(&function);
+    functions.push_back(&module.entrypoint);
 
-    for (auto bytes = 0zu; !stream.eof(); )
-    {
-        std::string line; std::getline(stream, line);
+    AssemblerContext context { .module = module };
+    auto sizes = lay_out_functions(context, functions);
 
-        if ((line.starts_with('.') && bytes > 0) || line == ".code")
-        {
-            dataSegment = code.substr(0, bytes);
-            codeSegment = code.substr(bytes + code.substr(bytes).find_first_of('.'));
+    auto dataSegmentSize = size_t(module.constants.size);
+    auto codeSegmentStart = HEADER_SIZE + dataSegmentSize;
 
-            break;
-        }
+    // with every size known up front, each part is written straight to where it belongs.
+    std::vector<uint8_t> program(codeSegmentStart + context.offsets.back() + sizes.back());
 
-        bytes += line.size();
-        bytes += line.empty() ? 0 : 1;
-    }
-
-    auto dataSegmentBytes = TRY(assemble_data_segment(dataSegment));
-    auto codeSegmentBytes = TRY(assemble_code_segment(codeSegment));
-
-    std::vector<uint8_t> program {};
-
-    std::ranges::copy("This is a kubo program", std::back_inserter(program));
-    program.pop_back();
+    Output header { .bytes = std::span(program).first(HEADER_SIZE), .size = MAGIC.size() };
+    std::ranges::copy(MAGIC, program.begin());
 
     // dataSegmentStart offset
-    std::ranges::copy(int_2_bytes(0), std::back_inserter(program));
+    write_int(header, 0);
     // codeSegmentStart offset
-    std::ranges::copy(int_2_bytes(static_cast<int32_t>(dataSegmentBytes.size())), std::back_inserter(program));
+    write_int(header, static_cast<int32_t>(dataSegmentSize));
     // entrypoint offset
-    std::ranges::copy(int_2_bytes(codeSegmentOffsets_g.at("entrypoint")), std::back_inserter(program));
+    write_int(header, static_cast<int32_t>(context.offsets.back()));
+
+    Output dataSegment { .bytes = std::span(program).subspan(HEADER_SIZE, dataSegmentSize) };
+    write_data_segment(module, dataSegment);
 
-    std::ranges::copy(dataSegmentBytes, std::back_inserter(program));
-    std::ranges::copy(codeSegmentBytes, std::back_inserter(program));
+    for_each_function(functions.size(), [&] (size_t index) {
+        Output output { .bytes = std::span(program).subspan(codeSegmentStart + context.offsets[index], sizes[index]) };
+        assemble_function(context, output, *functions[index], context.offsets[index]);
+        assert(output.size == sizes[index]);
+    });
 
     return program;
 }
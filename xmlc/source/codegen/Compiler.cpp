@@ -1,30 +1,73 @@
 #include "codegen/Compiler.hpp"
+#include "Intrinsics.hpp"
 #include "Parser.hpp"
+#include "ThreadPool.hpp"
 
 #include <fmt/core.h>
 #include <liberror/Try.hpp>
-#include <regex>
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <optional>
+#include <ranges>
 
 using namespace liberror;
 
-static std::map<std::string, int32_t> dataSegmentOffsets_g;
+// below this many functions, handing them out to other threads costs more than generating them.
+static constexpr size_t PARALLEL_FUNCTIONS_THRESHOLD = 64;
+
+// an if/else if chain over one variable becomes a jump table once it has this many cases, spread over at most this many
+// times as many values.
+static constexpr size_t JUMP_TABLE_MIN_CASES = 4;
+static constexpr size_t JUMP_TABLE_MAX_SPREAD = 2;
 
-struct Intrinsic
+struct CompilerContext
 {
-    std::string_view name;
-    std::string_view type;
+    ConstantPool constants {};
 };
 
-static constexpr std::array intrinsics_g {
-    Intrinsic { "print", "none" },
-    Intrinsic { "println", "none" }
-};
+static bool is_number(std::string_view value)
+{
+    if (value.starts_with('-')) value.remove_prefix(1);
+    return !value.empty() && std::ranges::all_of(value, ::isdigit);
+}
+
+static bool is_variable(LiteralExpr const* literal)
+{
+    return literal->segments.size() == 1 && literal->segments.front().kind == Segment::Kind::VARIABLE;
+}
+
+// an interpolated string is put together at run time, so only the text in between its variables is stored.
+static void intern_literal(CompilerContext& context, LiteralExpr const* literal)
+{
+    if (literal->segments.empty())
+    {
+        intern_constant(context.constants, literal->value);
+        return;
+    }
+
+    for (auto const& segment : literal->segments)
+    {
+        if (segment.kind == Segment::Kind::TEXT) intern_constant(context.constants, std::string_view(literal->value).substr(segment.offset, segment.size));
+    }
+}
+
+Result<void> generate_data_segment(CompilerContext& context, std::unique_ptr<Node> const& node);
 
-Result<std::string> generate_data_segment(std::unique_ptr<Node> const& node)
+static Result<void> generate_data_segment(CompilerContext& context, std::vector<std::unique_ptr<Node>> const& nodes)
 {
-    std::string code;
+    for (auto const& node : nodes)
+    {
+        TRY(generate_data_segment(context, node));
+    }
 
-    static int32_t dataSegmentBytes = 0;
+    return {};
+}
+
+Result<void> generate_data_segment(CompilerContext& context, std::unique_ptr<Node> const& node)
+{
+    if (!node) return {};
 
     switch (node->node_type())
     {
@@ -33,46 +76,41 @@ Result<std::string> generate_data_segment(std::unique_ptr<Node> const& node)
 
         switch (statement->stmt_type())
         {
-        case Statement::Type::CALL: {
-            for (std::string_view prefix = ""; auto const& child : static_cast<CallStmt const*>(statement)->arguments)
-            {
-                auto value = TRY(generate_data_segment(child));
-                if (value.empty()) continue;
-                code += prefix;
-                code += value;
-                prefix = "\n";
-            }
-
-            return code;
-        }
         case Statement::Type::LET: {
             auto letStmt = static_cast<LetStmt const*>(statement);
-            if (letStmt->type != "string") return {};
 
-            auto value = TRY(generate_data_segment(letStmt->value));
+            // a call may return a number and still take strings.
+            if (static_cast<Expression const*>(letStmt->value.get())->expr_type() != Expression::Type::LITERAL)
+            {
+                return generate_data_segment(context, letStmt->value);
+            }
+
+            auto literal = static_cast<LiteralExpr const*>(letStmt->value.get());
 
-            dataSegmentOffsets_g.insert({ letStmt->name, dataSegmentBytes });
-            dataSegmentBytes += 4 + value.size();
+            if (!is_variable(literal) && letStmt->type != "number") intern_literal(context, literal);
 
-            return fmt::format("{} {}", value.size(), value);
+            return {};
         }
         case Statement::Type::RETURN: {
             auto retStmt = static_cast<RetStmt const*>(statement);
-            if (retStmt->type == "none") return {};
+            if (!retStmt->value) return {};
 
-            auto value = TRY(generate_data_segment(retStmt->value));
-            if (value.empty()) return {};
-
-            if (retStmt->type == "string")
+            if (static_cast<Expression const*>(retStmt->value.get())->expr_type() != Expression::Type::LITERAL)
             {
-                dataSegmentOffsets_g.insert({ value, dataSegmentBytes });
+                return generate_data_segment(context, retStmt->value);
             }
 
-            dataSegmentBytes += 4 + value.size();
+            auto literal = static_cast<LiteralExpr const*>(retStmt->value.get());
+
+            if (!is_variable(literal) && retStmt->type != "number") intern_literal(context, literal);
 
-            return fmt::format("{} {}", value.size(), value);
+            return {};
+        }
+        case Statement::Type::IF: {
+            auto ifStmt = static_cast<IfStmt const*>(statement);
+            TRY(generate_data_segment(context, ifStmt->trueBranch));
+            return generate_data_segment(context, ifStmt->falseBranch);
         }
-        case Statement::Type::IF: break;
         }
 
         break;
@@ -82,382 +120,663 @@ Result<std::string> generate_data_segment(std::unique_ptr<Node> const& node)
 
         switch (expression->expr_type())
         {
-        case Expression::Type::ARITHMETIC: assert("UNREACHABLE" && false);
-        case Expression::Type::LOGICAL: assert("UNREACHABLE" && false);
+        // operands are only ever numbers and variables, neither of which lives in the data segment.
+        case Expression::Type::ARITHMETIC: break;
+        case Expression::Type::LOGICAL: break;
         case Expression::Type::ARG: {
-            auto value = TRY(generate_data_segment(static_cast<ArgExpr const*>(expression)->value));
+            auto const& argument = static_cast<ArgExpr const*>(expression)->value;
 
-            if (static_cast<Expression const*>(static_cast<ArgExpr const*>(expression)->value.get())->expr_type() != Expression::Type::LITERAL)
+            if (static_cast<Expression const*>(argument.get())->expr_type() != Expression::Type::LITERAL)
             {
-                return value;
+                return generate_data_segment(context, argument);
             }
 
-            if (!(std::all_of(value.begin(), value.end(), ::isdigit) || (value.starts_with("${") && value.ends_with('}'))))
-            {
-                dataSegmentOffsets_g.insert({ value, dataSegmentBytes });
-            }
-            else
-            {
-                return {};
-            }
+            auto literal = static_cast<LiteralExpr const*>(argument.get());
 
-            dataSegmentBytes += 4 + value.size();
-
-            std::regex pattern(R"((\$\{([\w]*)\}))");
-            std::sregex_iterator iterator(value.begin(), value.end(), pattern);
-
-            for (; iterator != std::sregex_iterator{}; iterator = std::next(iterator))
+            if (is_number(literal->value) || is_variable(literal))
             {
-                value.replace(size_t(iterator->position()), iterator->str(1).size(), "{}");
+                return {};
             }
 
-            return fmt::format("{} {}", value.size(), value);
-        }
-        case Expression::Type::CALL: {
-            for (std::string_view prefix = ""; auto const& child : static_cast<CallExpr const*>(expression)->arguments)
-            {
-                auto value = TRY(generate_data_segment(child));
-                if (value.empty()) continue;
-                code += prefix;
-                code += value;
-                prefix = "\n";
-            }
+            intern_literal(context, literal);
 
-            return code;
-        }
-        case Expression::Type::LITERAL: {
-            auto const& value = static_cast<LiteralExpr const*>(expression)->value;
-            if (value.starts_with("${") && value.ends_with('}')) return {};
-            return value;
+            return {};
         }
+        case Expression::Type::CALL: return generate_data_segment(context, static_cast<CallExpr const*>(expression)->arguments);
+        case Expression::Type::LITERAL: break;
         }
 
         break;
     }
-    case Node::Type::DECLARATION: {
-        auto declaration = static_cast<Declaration const*>(node.get());
+    case Node::Type::DECLARATION: return generate_data_segment(context, static_cast<Declaration const*>(node.get())->scope);
+    case Node::Type::ERROR: break;
+    }
 
-        for (std::string_view prefix; auto const& child : declaration->scope)
-        {
-            auto value = TRY(generate_data_segment(child));
-            if (value.empty()) continue;
-            code += prefix;
-            code += value;
-            prefix = "\n";
-        }
+    return {};
+}
 
-        break;
-    }
+static Result<int32_t> parse_number(std::string_view value)
+{
+    int32_t number {};
+
+    if (auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number); error != std::errc {} || end != value.data() + value.size())
+    {
+        return make_error("number '{}' does not fit in 32 bits", value);
     }
 
-    return code;
+    return number;
 }
 
-Result<std::string> compile_expression(ProgramDecl const* program, Declaration const* parent, Expression const* expression);
+Result<void> compile_expression(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, Expression const* expression, Function& function);
 
-Result<std::string> compile_literal_expression(ProgramDecl const*, Declaration const* parent, LiteralExpr const* expression)
+static Result<void> compile_constant_text(CompilerContext& context, std::string_view text, Function& function)
 {
-    std::vector<std::string> variables {};
-
-    if (parent->decl_type() == Declaration::Type::FUNCTION)
+    if (auto offset = find_constant(context.constants, text))
     {
-        auto const& parameters = static_cast<FunctionDecl const*>(parent)->parameters;
-        std::transform(parameters.begin(), parameters.end(), std::back_inserter(variables), [&] (auto&& parameter) { return parameter.first; });
+        function.code.push_back({ .opcode = Opcode::LOAD, .mode = uint8_t(DataSource::DATA_SEGMENT), .operand = *offset });
+        return {};
     }
 
-    for (auto const& child : parent->scope)
+    return make_error("literal '{}' was never added to the data segment", text);
+}
+
+// every piece of the string is pushed in order and concatenated onto the ones before it, numbers going through to_string.
+static Result<void> compile_interpolation(CompilerContext& context, LiteralExpr const* expression, Function& function)
+{
+    static constexpr auto CONCAT = *find_intrinsic("concat");
+    static constexpr auto TO_STRING = *find_intrinsic("to_string");
+
+    for (auto index = 0zu; auto const& segment : expression->segments)
     {
-        if (child->node_type() == Node::Type::STATEMENT && static_cast<Statement const*>(child.get())->stmt_type() == Statement::Type::LET)
+        auto text = std::string_view(expression->value).substr(segment.offset, segment.size);
+
+        if (segment.kind == Segment::Kind::TEXT)
+        {
+            TRY(compile_constant_text(context, text, function));
+        }
+        else if (segment.slot.has_value())
+        {
+            function.code.push_back({ .opcode = Opcode::LOAD, .mode = uint8_t(DataSource::LOCAL_SCOPE), .operand = int32_t(*segment.slot) });
+            if (segment.numeric) function.code.push_back({ .opcode = Opcode::CALL, .mode = uint8_t(CallMode::INTRINSIC), .operand = int32_t(TO_STRING) });
+        }
+        else
         {
-            variables.push_back(static_cast<LetStmt const*>(child.get())->name);
+            return make_error("interpolated variable '{}' was never resolved", text);
         }
+
+        if (index++ > 0) function.code.push_back({ .opcode = Opcode::CALL, .mode = uint8_t(CallMode::INTRINSIC), .operand = int32_t(CONCAT) });
     }
 
-    if (std::all_of(expression->value.begin(), expression->value.end(), ::isdigit))
+    return {};
+}
+
+static Result<void> compile_string_literal(CompilerContext& context, LiteralExpr const* expression, Function& function)
+{
+    if (expression->segments.empty()) return compile_constant_text(context, expression->value, function);
+
+    return compile_interpolation(context, expression, function);
+}
+
+Result<void> compile_literal_expression(CompilerContext& context, ProgramDecl const*, Declaration const*, LiteralExpr const* expression, Function& function)
+{
+    if (expression->slot.has_value())
+    {
+        function.code.push_back({ .opcode = Opcode::LOAD, .mode = uint8_t(DataSource::LOCAL_SCOPE), .operand = int32_t(*expression->slot) });
+        return {};
+    }
+    else if (is_number(expression->value))
     {
-        return fmt::format("push {}", expression->value);
+        function.code.push_back({ .opcode = Opcode::PUSH, .operand = TRY(parse_number(expression->value)) });
+        return {};
     }
-    else if (expression->value.starts_with("${") && expression->value.ends_with('}'))
+
+    return compile_string_literal(context, expression, function);
+}
+
+static Arithmetic arithmetic_of(ArithmeticExpr::Operator op)
+{
+    switch (op)
     {
-        std::regex pattern(R"((\$\{([\w]*)\}))");
-        std::smatch match;
+    case ArithmeticExpr::Operator::ADD: return Arithmetic::ADD;
+    case ArithmeticExpr::Operator::SUBTRACT: return Arithmetic::SUBTRACT;
+    case ArithmeticExpr::Operator::MULTIPLY: return Arithmetic::MULTIPLY;
+    case ArithmeticExpr::Operator::DIVIDE: return Arithmetic::DIVIDE;
+    case ArithmeticExpr::Operator::MODULO: return Arithmetic::MODULO;
+    case ArithmeticExpr::Operator::NEGATE: return Arithmetic::NEGATE;
+    }
 
-        std::regex_search(expression->value, match, pattern);
+    return Arithmetic::ADD;
+}
 
-        auto maybeVariable = std::find_if(variables.begin(), variables.end(), [&] (auto&& variable) { return variable == match.str(2); });
-        assert("FIXME: should emit undeclared variable error" && maybeVariable != variables.end());
+// the analyzer already made sure both operands are numbers, so this is always the 32 bit integer instruction.
+Result<void> compile_arithmetic_expression(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, ArithmeticExpr const* expression, Function& function)
+{
+    TRY(compile_expression(context, program, parent, static_cast<Expression const*>(expression->lhs.get()), function));
 
-        return fmt::format("load scope[{}]", std::distance(variables.begin(), maybeVariable));
+    if (expression->rhs)
+    {
+        TRY(compile_expression(context, program, parent, static_cast<Expression const*>(expression->rhs.get()), function));
     }
-    else if (dataSegmentOffsets_g.contains(expression->value))
+
+    function.code.push_back({ .opcode = Opcode::ARITHMETIC, .mode = uint8_t(arithmetic_of(expression->op)) });
+
+    return {};
+}
+
+static std::optional<Comparison> comparison_of(LogicalExpr::Operator op)
+{
+    switch (op)
     {
-        return fmt::format("load .data[{}]", dataSegmentOffsets_g.at(expression->value));
+    case LogicalExpr::Operator::EQUAL: return Comparison::EQUAL;
+    case LogicalExpr::Operator::NOT_EQUAL: return Comparison::NOT_EQUAL;
+    case LogicalExpr::Operator::LESS: return Comparison::LESS;
+    case LogicalExpr::Operator::LESS_EQUAL: return Comparison::LESS_EQUAL;
+    case LogicalExpr::Operator::GREATER: return Comparison::GREATER;
+    case LogicalExpr::Operator::GREATER_EQUAL: return Comparison::GREATER_EQUAL;
+    case LogicalExpr::Operator::AND:
+    case LogicalExpr::Operator::OR:
+    case LogicalExpr::Operator::NOT: break;
     }
 
-    assert("UNREACHABLE" && false);
+    return std::nullopt;
 }
 
-Result<std::string> compile_arithmetic_expression(ProgramDecl const*, Declaration const* , ArithmeticExpr const* )
+// numbers are compared as integers, anything else has to be compared by its type and contents at run time.
+static void emit_comparison(Function& function, LogicalExpr const* expression)
 {
-    assert("UNIMPLEMENTED" && false);
+    function.code.push_back({ .opcode = expression->numeric ? Opcode::COMPARE : Opcode::EQUALS, .mode = uint8_t(*comparison_of(expression->op)) });
 }
 
-Result<std::string> compile_logical_expression(ProgramDecl const*, Declaration const*, LogicalExpr const*)
+static void emit_jump(Function& function, JumpCondition condition, int32_t label)
 {
-    assert("UNIMPLEMENTED" && false);
+    function.code.push_back({ .opcode = Opcode::JUMP, .mode = uint8_t(condition), .operand = label });
 }
 
-Result<std::string> compile_arg_expression(ProgramDecl const* program, Declaration const* parent, ArgExpr const* statement)
+static void emit_label(Function& function, int32_t label)
 {
-    return TRY(compile_expression(program, parent, static_cast<Expression const*>(statement->value.get())));
+    function.code.push_back({ .opcode = Opcode::LABEL, .operand = label });
 }
 
-Result<std::string> compile_call_expression(ProgramDecl const* program, Declaration const* parent, CallExpr const* expression)
+// Jumps to `label` when the condition is `jumpIf`, and falls through otherwise. `&&`, `||` and `!` never produce a value
+// here, they only decide where each operand jumps to.
+static Result<void> compile_condition(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, Expression const* condition, Function& function, int32_t label, bool jumpIf)
 {
-    std::string code {};
+    if (condition->expr_type() != Expression::Type::LOGICAL)
+    {
+        TRY(compile_expression(context, program, parent, condition, function));
+        emit_jump(function, jumpIf ? JumpCondition::IF_TRUE : JumpCondition::IF_FALSE, label);
+        return {};
+    }
 
-    for (auto const& child : expression->arguments)
+    auto logicalExpr = static_cast<LogicalExpr const*>(condition);
+    auto lhs = static_cast<Expression const*>(logicalExpr->lhs.get());
+    auto rhs = static_cast<Expression const*>(logicalExpr->rhs.get());
+
+    switch (logicalExpr->op)
     {
-        code += TRY(compile_arg_expression(program, parent, static_cast<ArgExpr const*>(child.get())));
-        code += '\n';
+    case LogicalExpr::Operator::NOT: return compile_condition(context, program, parent, lhs, function, label, !jumpIf);
+    case LogicalExpr::Operator::AND:
+    case LogicalExpr::Operator::OR: {
+        // when the left side alone settles it the same way as `jumpIf`, it jumps straight to `label`, otherwise it skips
+        // over the right side.
+        auto settles = logicalExpr->op == LogicalExpr::Operator::OR;
+
+        if (settles == jumpIf)
+        {
+            TRY(compile_condition(context, program, parent, lhs, function, label, jumpIf));
+            return compile_condition(context, program, parent, rhs, function, label, jumpIf);
+        }
+
+        auto skip = make_label(function);
+        TRY(compile_condition(context, program, parent, lhs, function, skip, settles));
+        TRY(compile_condition(context, program, parent, rhs, function, label, jumpIf));
+        emit_label(function, skip);
+
+        return {};
     }
+    case LogicalExpr::Operator::EQUAL:
+    case LogicalExpr::Operator::NOT_EQUAL:
+    case LogicalExpr::Operator::LESS:
+    case LogicalExpr::Operator::LESS_EQUAL:
+    case LogicalExpr::Operator::GREATER:
+    case LogicalExpr::Operator::GREATER_EQUAL: break;
+    }
+
+    TRY(compile_expression(context, program, parent, lhs, function));
+    TRY(compile_expression(context, program, parent, rhs, function));
 
-    auto maybeIntrinsic = std::find_if(intrinsics_g.begin(), intrinsics_g.end(), [&] (auto&& intrinsic) {
-        return intrinsic.name == expression->who;
-    });
+    emit_comparison(function, logicalExpr);
+    emit_jump(function, jumpIf ? JumpCondition::IF_TRUE : JumpCondition::IF_FALSE, label);
 
-    if (maybeIntrinsic == intrinsics_g.end())
+    return {};
+}
+
+Result<void> compile_logical_expression(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, LogicalExpr const* expression, Function& function)
+{
+    if (comparison_of(expression->op))
     {
-        code += fmt::format("call {}", expression->who);
+        TRY(compile_expression(context, program, parent, static_cast<Expression const*>(expression->lhs.get()), function));
+        TRY(compile_expression(context, program, parent, static_cast<Expression const*>(expression->rhs.get()), function));
+        emit_comparison(function, expression);
+        return {};
     }
-    else
+
+    auto falseLabel = make_label(function);
+    auto endLabel = make_label(function);
+
+    TRY(compile_condition(context, program, parent, expression, function, falseLabel, false));
+
+    function.code.push_back({ .opcode = Opcode::PUSH, .operand = 1 });
+    emit_jump(function, JumpCondition::ALWAYS, endLabel);
+    emit_label(function, falseLabel);
+    function.code.push_back({ .opcode = Opcode::PUSH, .operand = 0 });
+    emit_label(function, endLabel);
+
+    return {};
+}
+
+Result<void> compile_arg_expression(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, ArgExpr const* statement, Function& function)
+{
+    return compile_expression(context, program, parent, static_cast<Expression const*>(statement->value.get()), function);
+}
+
+Result<void> compile_call_expression(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, CallExpr const* expression, Function& function)
+{
+    for (auto const& child : expression->arguments)
+    {
+        TRY(compile_arg_expression(context, program, parent, static_cast<ArgExpr const*>(child.get()), function));
+    }
+
+    switch (expression->callee.kind)
     {
-        code += fmt::format("call {}", maybeIntrinsic->name);
+    case Callee::Kind::INTRINSIC: {
+        function.code.push_back({ .opcode = Opcode::CALL, .mode = uint8_t(CallMode::INTRINSIC), .operand = int32_t(expression->callee.index) });
+        break;
+    }
+    case Callee::Kind::FUNCTION: {
+        function.code.push_back({ .opcode = Opcode::CALL, .mode = uint8_t(CallMode::EXTRINSIC), .operand = int32_t(expression->callee.index) });
+        break;
+    }
+    case Callee::Kind::UNRESOLVED: {
+        return make_error("call to '{}' was never resolved", expression->who);
+    }
     }
 
-    return code;
+    if (expression->discarded && expression->type != "none")
+    {
+        function.code.push_back({ .opcode = Opcode::POP });
+    }
+
+    return {};
 }
 
-Result<std::string> compile_expression(ProgramDecl const* program, Declaration const* parent, Expression const* expression)
+Result<void> compile_expression(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, Expression const* expression, Function& function)
 {
     switch (expression->expr_type())
     {
-    case Expression::Type::ARG: break;
-    case Expression::Type::LITERAL: return compile_literal_expression(program, parent, static_cast<LiteralExpr const*>(expression));
-    case Expression::Type::LOGICAL: return compile_logical_expression(program, parent, static_cast<LogicalExpr const*>(expression));
-    case Expression::Type::ARITHMETIC: return compile_arithmetic_expression(program, parent, static_cast<ArithmeticExpr const*>(expression));
-    case Expression::Type::CALL: return compile_call_expression(program, parent, static_cast<CallExpr const*>(expression));
+    case Expression::Type::ARG: return compile_arg_expression(context, program, parent, static_cast<ArgExpr const*>(expression), function);
+    case Expression::Type::LITERAL: return compile_literal_expression(context, program, parent, static_cast<LiteralExpr const*>(expression), function);
+    case Expression::Type::LOGICAL: return compile_logical_expression(context, program, parent, static_cast<LogicalExpr const*>(expression), function);
+    case Expression::Type::ARITHMETIC: return compile_arithmetic_expression(context, program, parent, static_cast<ArithmeticExpr const*>(expression), function);
+    case Expression::Type::CALL: return compile_call_expression(context, program, parent, static_cast<CallExpr const*>(expression), function);
     }
 
-    assert("UNREACHABLE" && false);
+    return make_error("expression of an unknown type {}", int(expression->expr_type()));
 }
 
-Result<std::string> compile_statement(ProgramDecl const* program, Declaration const* parent, Statement const* statement);
+Result<void> compile_statement(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, Statement const* statement, Function& function);
 
-Result<std::string> compile_ret_statement(ProgramDecl const* program, Declaration const* parent, RetStmt const* statement)
+// a let or a return knows the type of its value, so a string made only of digits is still loaded as a string.
+static Result<void> compile_typed_value(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, std::string_view type, Node const* value, Function& function)
 {
-    std::string code {};
+    auto expression = static_cast<Expression const*>(value);
+
+    if (type != "number" && expression->expr_type() == Expression::Type::LITERAL && !static_cast<LiteralExpr const*>(expression)->slot.has_value())
+    {
+        return compile_string_literal(context, static_cast<LiteralExpr const*>(expression), function);
+    }
+
+    return compile_expression(context, program, parent, expression, function);
+}
 
+Result<void> compile_ret_statement(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, RetStmt const* statement, Function& function)
+{
     if (statement->value)
     {
-        code += TRY(compile_expression(program, parent, static_cast<Expression const*>(statement->value.get())));
-        code += '\n';
+        TRY(compile_typed_value(context, program, parent, statement->type, statement->value.get(), function));
     }
 
-    code += "ret";
+    function.code.push_back({ .opcode = Opcode::RET });
 
-    return code;
+    return {};
 }
 
-Result<std::string> compile_let_statement(ProgramDecl const*, Declaration const* parent, LetStmt const* statement)
+Result<void> compile_let_statement(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, LetStmt const* statement, Function& function)
 {
-    std::string code {};
+    TRY(compile_typed_value(context, program, parent, statement->type, statement->value.get(), function));
 
-    auto expression = static_cast<Expression const*>(statement->value.get());
+    function.code.push_back({ .opcode = Opcode::STORE, .mode = uint8_t(DataDestination::LOCAL_SCOPE), .operand = int32_t(statement->slot) });
 
-    if (expression->expr_type() == Expression::Type::LITERAL)
-    {
-        auto literal = static_cast<LiteralExpr const*>(expression);
+    return {};
+}
 
-        if (statement->type == "number")
+static Result<void> compile_nodes(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, std::vector<std::unique_ptr<Node>> const& nodes, Function& function)
+{
+    for (auto const& child : nodes)
+    {
+        if (child->node_type() == Node::Type::EXPRESSION)
         {
-            code += fmt::format("push {}", literal->value);
+            TRY(compile_expression(context, program, parent, static_cast<Expression const*>(child.get()), function));
         }
-        else if (statement->type == "string")
+        else
         {
-            code += fmt::format("load .data[{}]", dataSegmentOffsets_g.at(statement->name));
+            TRY(compile_statement(context, program, parent, static_cast<Statement const*>(child.get()), function));
         }
     }
-    else if (expression->expr_type() == Expression::Type::ARITHMETIC)
-    {
-        assert("UNIMPLEMENTED" && false);
-    }
-    else if (expression->expr_type() == Expression::Type::LOGICAL)
-    {
-        assert("UNIMPLEMENTED" && false);
-    }
 
-    auto variable = std::find_if(parent->scope.begin(), parent->scope.end(), [&] (std::unique_ptr<Node> const& node) {
-        return node->node_type() == Node::Type::STATEMENT &&
-               static_cast<Statement const*>(node.get())->stmt_type() == Statement::Type::LET &&
-               static_cast<LetStmt const*>(node.get())->name == statement->name;
-    });
+    return {};
+}
 
-    assert(variable != parent->scope.end());
+static bool ends_with_return(std::vector<std::unique_ptr<Node>> const& branch)
+{
+    return !branch.empty() && branch.back()->node_type() == Node::Type::STATEMENT
+        && static_cast<Statement const*>(branch.back().get())->stmt_type() == Statement::Type::RETURN;
+}
 
-    code += fmt::format("\nstore scope[{}]", std::distance(parent->scope.begin(), variable));
+struct SwitchCase
+{
+    int32_t value {};
+    std::vector<std::unique_ptr<Node>> const* branch {};
+};
 
-    return code;
-}
+struct Switch
+{
+    LiteralExpr const* variable {};
+    std::vector<SwitchCase> cases {};
+    std::vector<std::unique_ptr<Node>> const* fallback {};
+};
 
-Result<std::string> compile_call_statement(ProgramDecl const* program, Declaration const* parent, CallStmt const* statement)
+// the `${variable} == constant` an if compares against, in either order.
+static std::optional<std::pair<LiteralExpr const*, int32_t>> match_switch_case(Node const* condition)
 {
-    std::string code {};
+    if (static_cast<Expression const*>(condition)->expr_type() != Expression::Type::LOGICAL) return std::nullopt;
 
-    for (auto const& child : statement->arguments)
-    {
-        code += TRY(compile_arg_expression(program, parent, static_cast<ArgExpr const*>(child.get())));
-        code += '\n';
-    }
+    auto logicalExpr = static_cast<LogicalExpr const*>(condition);
 
-    auto maybeIntrinsic = std::find_if(intrinsics_g.begin(), intrinsics_g.end(), [&] (auto&& intrinsic) {
-        return intrinsic.name == statement->who;
-    });
+    if (logicalExpr->op != LogicalExpr::Operator::EQUAL || !logicalExpr->numeric) return std::nullopt;
 
-    if (maybeIntrinsic == intrinsics_g.end())
-    {
-        code += fmt::format("call {}", statement->who);
+    auto as_literal = [] (Node const* node) -> LiteralExpr const* {
+        if (static_cast<Expression const*>(node)->expr_type() != Expression::Type::LITERAL) return nullptr;
+        return static_cast<LiteralExpr const*>(node);
+    };
 
-        auto function = std::find_if(program->scope.begin(), program->scope.end(), [&] (std::unique_ptr<Node> const& node) {
-            return node->node_type() == Node::Type::DECLARATION &&
-                   static_cast<Declaration const*>(node.get())->decl_type() == Declaration::Type::FUNCTION &&
-                   static_cast<FunctionDecl const*>(node.get())->name == statement->who;
-        });
+    auto lhs = as_literal(logicalExpr->lhs.get());
+    auto rhs = as_literal(logicalExpr->rhs.get());
+
+    if (!lhs || !rhs) return std::nullopt;
+    if (!lhs->slot.has_value()) std::swap(lhs, rhs);
+    if (!lhs->slot.has_value() || rhs->slot.has_value() || !rhs->segments.empty() || !is_number(rhs->value)) return std::nullopt;
+
+    auto value = parse_number(rhs->value);
+    if (!value.has_value()) return std::nullopt;
+
+    return std::pair { lhs, value.value() };
+}
+
+// Follows an if/else if chain for as long as every condition compares the same variable against a constant.
+static Switch collect_switch(IfStmt const* statement)
+{
+    Switch switchStmt {};
 
-        assert(function != program->scope.end());
+    while (true)
+    {
+        auto match = match_switch_case(statement->condition.get());
+
+        if (!match.has_value() || (switchStmt.variable && *match->first->slot != *switchStmt.variable->slot)) break;
 
-        if (static_cast<FunctionDecl const*>(function->get())->type != "none")
+        switchStmt.variable = match->first;
+        // a value already taken by an earlier case can never reach this one.
+        if (std::ranges::find(switchStmt.cases, match->second, &SwitchCase::value) == switchStmt.cases.end())
         {
-            code += '\n';
-            code += "pop";
+            switchStmt.cases.push_back({ .value = match->second, .branch = &statement->trueBranch });
         }
-    }
-    else
-    {
-        code += fmt::format("call {}", maybeIntrinsic->name);
+        switchStmt.fallback = &statement->falseBranch;
+
+        auto const& next = statement->falseBranch;
 
-        if (maybeIntrinsic->type != "none")
+        if (next.size() != 1 || next.front()->node_type() != Node::Type::STATEMENT || static_cast<Statement const*>(next.front().get())->stmt_type() != Statement::Type::IF)
         {
-            code += '\n';
-            code += "pop";
+            break;
         }
+
+        statement = static_cast<IfStmt const*>(next.front().get());
     }
 
-    return code;
+    return switchStmt;
 }
 
-Result<std::string> compile_if_statement(ProgramDecl const*, Declaration const*, IfStmt const*)
+// worth a table once there are enough cases to skip past, and they are packed tightly enough that the table is mostly
+// made of them.
+static bool is_worth_a_table(Switch const& switchStmt)
 {
-    assert("UNIMPLEMENTED" && false);
+    if (switchStmt.cases.size() < JUMP_TABLE_MIN_CASES) return false;
+
+    auto [low, high] = std::ranges::minmax(switchStmt.cases | std::views::transform(&SwitchCase::value));
+
+    return int64_t(high) - int64_t(low) + 1 <= int64_t(switchStmt.cases.size() * JUMP_TABLE_MAX_SPREAD);
+}
+
+static Result<void> compile_switch(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, Switch const& switchStmt, Function& function)
+{
+    auto [low, high] = std::ranges::minmax(switchStmt.cases | std::views::transform(&SwitchCase::value));
+
+    auto endLabel = make_label(function);
+    JumpTable table { .low = low, .labels = std::vector<int32_t>(size_t(int64_t(high) - low + 1)), .fallback = make_label(function) };
+
+    std::ranges::fill(table.labels, table.fallback);
+
+    std::vector<int32_t> labels {};
+
+    for (auto const& switchCase : switchStmt.cases)
+    {
+        labels.push_back(make_label(function));
+        table.labels[size_t(int64_t(switchCase.value) - low)] = labels.back();
+    }
+
+    TRY(compile_literal_expression(context, program, parent, switchStmt.variable, function));
+
+    function.code.push_back({ .opcode = Opcode::JUMP_TABLE, .operand = int32_t(function.tables.size()) });
+    function.tables.push_back(std::move(table));
+
+    for (auto index = 0zu; index < switchStmt.cases.size(); index += 1)
+    {
+        emit_label(function, labels[index]);
+        TRY(compile_nodes(context, program, parent, *switchStmt.cases[index].branch, function));
+        if (!ends_with_return(*switchStmt.cases[index].branch)) emit_jump(function, JumpCondition::ALWAYS, endLabel);
+    }
+
+    emit_label(function, function.tables.back().fallback);
+    TRY(compile_nodes(context, program, parent, *switchStmt.fallback, function));
+    emit_label(function, endLabel);
+
     return {};
 }
 
-Result<std::string> compile_statement(ProgramDecl const* program, Declaration const* parent, Statement const* statement)
+// an if is only left in the tree when its condition could not be folded.
+Result<void> compile_if_statement(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, IfStmt const* statement, Function& function)
 {
-    if (statement->stmt_type() == Statement::Type::LET)
+    if (auto switchStmt = collect_switch(statement); is_worth_a_table(switchStmt))
+    {
+        return compile_switch(context, program, parent, switchStmt, function);
+    }
+
+    auto condition = static_cast<Expression const*>(statement->condition.get());
+    auto endLabel = make_label(function);
+
+    if (statement->falseBranch.empty())
     {
-        return compile_let_statement(program, parent, static_cast<LetStmt const*>(statement));
+        TRY(compile_condition(context, program, parent, condition, function, endLabel, false));
+        TRY(compile_nodes(context, program, parent, statement->trueBranch, function));
+        emit_label(function, endLabel);
+        return {};
     }
 
-    if (statement->stmt_type() == Statement::Type::CALL)
+    // the branch that is more likely to run goes first, right after the test, so that it never has to jump. with no
+    // profile to go by, a branch that returns while the other keeps going is taken to be the unlikely one, the usual
+    // shape of an early exit.
+    auto trueIsLikely = !ends_with_return(statement->trueBranch) || ends_with_return(statement->falseBranch);
+
+    auto const& likely = trueIsLikely ? statement->trueBranch : statement->falseBranch;
+    auto const& unlikely = trueIsLikely ? statement->falseBranch : statement->trueBranch;
+
+    auto unlikelyLabel = make_label(function);
+
+    TRY(compile_condition(context, program, parent, condition, function, unlikelyLabel, !trueIsLikely));
+    TRY(compile_nodes(context, program, parent, likely, function));
+    if (!ends_with_return(likely)) emit_jump(function, JumpCondition::ALWAYS, endLabel);
+    emit_label(function, unlikelyLabel);
+    TRY(compile_nodes(context, program, parent, unlikely, function));
+    emit_label(function, endLabel);
+
+    return {};
+}
+
+Result<void> compile_statement(CompilerContext& context, ProgramDecl const* program, Declaration const* parent, Statement const* statement, Function& function)
+{
+    if (statement->stmt_type() == Statement::Type::LET)
     {
-        return compile_call_statement(program, parent, static_cast<CallStmt const*>(statement));
+        return compile_let_statement(context, program, parent, static_cast<LetStmt const*>(statement), function);
     }
 
     if (statement->stmt_type() == Statement::Type::RETURN)
     {
-        return compile_ret_statement(program, parent, static_cast<RetStmt const*>(statement));
+        return compile_ret_statement(context, program, parent, static_cast<RetStmt const*>(statement), function);
     }
 
     if (statement->stmt_type() == Statement::Type::IF)
     {
-        return compile_if_statement(program, parent, static_cast<IfStmt const*>(statement));
+        return compile_if_statement(context, program, parent, static_cast<IfStmt const*>(statement), function);
     }
 
     return {};
 }
 
-Result<std::string> compile_declaration(ProgramDecl const* program, Declaration const* declaration);
-
-Result<std::string> compile_function_declaration(ProgramDecl const* program, FunctionDecl const* declaration)
+// A block that is only ever jumped to and ends in a return never needs to come back, so it can live past the end of the
+// function, and whatever jumped over it to get on with the likely path can just fall through instead. Only blocks with
+// no jumps of their own are moved, a jump out of one would go back to a label it was moved past, and every jump has to
+// stay forward.
+static void move_cold_blocks(Function& function)
 {
-    std::string code = fmt::format("function {}\n\n", declaration->name);
+    std::vector<Instruction> code {};
+    std::vector<Instruction> cold {};
 
-    // cppcheck-suppress [variableScope]
-    for (std::string_view separator = ""; auto const& child : declaration->scope)
+    code.reserve(function.code.size());
+
+    for (auto position = 0zu; position < function.code.size(); )
     {
-        code += separator;
-        code += TRY(compile_statement(program, declaration, static_cast<Statement const*>(child.get())));
-        separator = "\n";
+        auto const& instruction = function.code[position];
+
+        auto isEntered = instruction.opcode == Opcode::LABEL && position > 0
+            && (function.code[position - 1].opcode == Opcode::RET
+                || (function.code[position - 1].opcode == Opcode::JUMP && JumpCondition(function.code[position - 1].mode) == JumpCondition::ALWAYS));
+
+        auto end = std::find_if(function.code.begin() + ptrdiff_t(position) + 1, function.code.end(), [] (Instruction const& next) {
+            return next.opcode == Opcode::LABEL || next.opcode == Opcode::RET;
+        });
+
+        auto jumps = std::any_of(function.code.begin() + ptrdiff_t(position) + 1, end, [] (Instruction const& inner) {
+            return inner.opcode == Opcode::JUMP || inner.opcode == Opcode::JUMP_TABLE;
+        });
+
+        if (!isEntered || end == function.code.end() || end->opcode != Opcode::RET || std::next(end) == function.code.end() || jumps)
+        {
+            code.push_back(instruction);
+            position += 1;
+            continue;
+        }
+
+        auto next = size_t(std::distance(function.code.begin(), end)) + 1;
+
+        std::copy(function.code.begin() + ptrdiff_t(position), function.code.begin() + ptrdiff_t(next), std::back_inserter(cold));
+        position = next;
     }
 
-    return code;
+    std::ranges::copy(cold, std::back_inserter(code));
+
+    function.code = std::move(code);
 }
 
-Result<std::string> compile_declaration(ProgramDecl const* program, Declaration const* declaration)
+Result<Function> compile_function_declaration(CompilerContext& context, ProgramDecl const* program, FunctionDecl const* declaration)
 {
-    if (declaration->decl_type() == Declaration::Type::FUNCTION)
-    {
-        return compile_function_declaration(program, static_cast<FunctionDecl const*>(declaration));
-    }
+    Function function { .name = declaration->name, .parameters = declaration->parameters.size() };
 
-    return {};
+    TRY(compile_nodes(context, program, declaration, declaration->scope, function));
+
+    move_cold_blocks(function);
+
+    return function;
 }
 
-Result<std::string> compile_program(ProgramDecl const* declaration)
+Result<void> compile_program(CompilerContext& context, Module& module, ProgramDecl const* declaration)
 {
-    std::string code {};
+    std::vector<FunctionDecl const*> functions {};
 
-    for (std::string_view prefix = ""; auto const& child : declaration->scope)
+    for (auto const& child : declaration->scope)
     {
-        if (child->node_type() == Node::Type::DECLARATION)
+        if (child->node_type() == Node::Type::DECLARATION && static_cast<Declaration const*>(child.get())->decl_type() == Declaration::Type::FUNCTION)
         {
-            code += prefix;
-            code += TRY(compile_declaration(declaration, static_cast<Declaration const*>(child.get())));
-            prefix = "\n\n";
+            functions.push_back(static_cast<FunctionDecl const*>(child.get()));
         }
     }
 
-    if (!code.empty()) code += "\n\n";
-    code += "entrypoint\n\n";
+    // past the data segment, functions only read from the context, so each one can be generated on its own and the
+    // results are put back together in declaration order.
+    std::vector<std::optional<Result<Function>>> results(functions.size());
+
+    auto generate = [&] (size_t index) {
+        results[index].emplace(compile_function_declaration(context, declaration, functions[index]));
+    };
+
+    if (functions.size() < PARALLEL_FUNCTIONS_THRESHOLD)
+    {
+        for (auto index = 0zu; index < functions.size(); index += 1) generate(index);
+    }
+    else
+    {
+        parallel_for(shared_thread_pool(), functions.size(), generate);
+    }
+
+    module.functions.reserve(functions.size());
+
+    for (auto& result : results)
+    {
+        module.functions.push_back(TRY(std::move(*result)));
+    }
+
+    module.entrypoint.name = "entrypoint";
 
     for (auto const& child : declaration->scope)
     {
-        if (child->node_type() == Node::Type::STATEMENT && static_cast<Statement const*>(child.get())->stmt_type() == Statement::Type::CALL)
+        if (child->node_type() == Node::Type::EXPRESSION && static_cast<Expression const*>(child.get())->expr_type() == Expression::Type::CALL)
         {
-            code += TRY(compile_statement(declaration, declaration, static_cast<Statement const*>(child.get())));
-            code += '\n';
+            TRY(compile_expression(context, declaration, declaration, static_cast<Expression const*>(child.get()), module.entrypoint));
         }
     }
 
-    code += "ret";
+    module.entrypoint.code.push_back({ .opcode = Opcode::RET });
 
-    return code;
+    return {};
 }
 
-Result<std::string> compile(std::unique_ptr<Node> const& ast)
+Result<Module> compile(std::unique_ptr<Node> const& ast)
 {
-    std::string dataSegment;
-    auto data = TRY(generate_data_segment(ast));
-    if (!data.empty())
-    {
-        dataSegment += ".data\n";
-        dataSegment += fmt::format("\n{}\n\n", data);
-    }
+    CompilerContext context {};
+    Module module {};
+
+    TRY(generate_data_segment(context, ast));
+    TRY(compile_program(context, module, static_cast<ProgramDecl const*>(ast.get())));
 
-    std::string codeSegment = ".code\n";
-    auto code = TRY(compile_program(static_cast<ProgramDecl const*>(ast.get())));
-    if (!code.empty()) codeSegment += fmt::format("\n{}", code);
+    module.constants = std::move(context.constants);
 
-    return dataSegment + codeSegment;
+    return module;
 }
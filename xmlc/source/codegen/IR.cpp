@@ -0,0 +1,250 @@
+#include "codegen/IR.hpp"
+#include "Intrinsics.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+static constexpr size_t MIN_BUCKETS = 64;
+
+static std::optional<size_t> find_bucket(ConstantPool const& pool, size_t hash, std::string_view value)
+{
+    if (pool.buckets.empty()) return std::nullopt;
+
+    auto mask = pool.buckets.size() - 1;
+
+    for (auto bucket = hash & mask; ; bucket = (bucket + 1) & mask)
+    {
+        auto entry = pool.buckets[bucket];
+
+        if (entry == 0) return bucket;
+        if (pool.hashes[entry - 1] == hash && pool.entries[entry - 1] == value) return bucket;
+    }
+}
+
+static void grow_buckets(ConstantPool& pool)
+{
+    std::vector<uint32_t> buckets(std::max(MIN_BUCKETS, pool.buckets.size() * 2));
+
+    auto mask = buckets.size() - 1;
+
+    for (auto entry = 0zu; entry < pool.entries.size(); entry += 1)
+    {
+        auto bucket = pool.hashes[entry] & mask;
+        while (buckets[bucket] != 0) bucket = (bucket + 1) & mask;
+        buckets[bucket] = uint32_t(entry + 1);
+    }
+
+    pool.buckets = std::move(buckets);
+}
+
+int32_t intern_constant(ConstantPool& pool, std::string_view value)
+{
+    pool.references += 1;
+
+    // staying at most half full keeps the probe sequences short.
+    if ((pool.entries.size() + 1) * 2 > pool.buckets.size()) grow_buckets(pool);
+
+    auto hash = std::hash<std::string_view> {}(value);
+    auto bucket = *find_bucket(pool, hash, value);
+
+    if (auto entry = pool.buckets[bucket]; entry != 0)
+    {
+        pool.savedBytes += 4 + value.size();
+        return pool.offsets[entry - 1];
+    }
+
+    pool.buckets[bucket] = uint32_t(pool.entries.size() + 1);
+
+    pool.entries.emplace_back(value);
+    pool.hashes.push_back(hash);
+    pool.offsets.push_back(pool.size);
+
+    pool.size += 4 + int32_t(value.size());
+
+    return pool.offsets.back();
+}
+
+std::optional<int32_t> find_constant(ConstantPool const& pool, std::string_view value)
+{
+    auto bucket = find_bucket(pool, std::hash<std::string_view> {}(value), value);
+
+    if (!bucket.has_value() || pool.buckets[*bucket] == 0) return std::nullopt;
+
+    return pool.offsets[pool.buckets[*bucket] - 1];
+}
+
+bool is_extrinsic_call(Instruction const& instruction)
+{
+    return instruction.opcode == Opcode::CALL && CallMode(instruction.mode) != CallMode::INTRINSIC;
+}
+
+bool is_local_load(Instruction const& instruction)
+{
+    return instruction.opcode == Opcode::LOAD && DataSource(instruction.mode) == DataSource::LOCAL_SCOPE;
+}
+
+bool is_local_store(Instruction const& instruction)
+{
+    return instruction.opcode == Opcode::STORE && DataDestination(instruction.mode) == DataDestination::LOCAL_SCOPE;
+}
+
+int32_t make_label(Function& function)
+{
+    return int32_t(function.labels++);
+}
+
+static std::string_view comparison_name(Comparison comparison)
+{
+    switch (comparison)
+    {
+    case Comparison::EQUAL: return "equal";
+    case Comparison::NOT_EQUAL: return "not_equal";
+    case Comparison::LESS: return "less";
+    case Comparison::LESS_EQUAL: return "less_equal";
+    case Comparison::GREATER: return "greater";
+    case Comparison::GREATER_EQUAL: return "greater_equal";
+    }
+
+    return "<invalid comparison>";
+}
+
+static std::string_view arithmetic_name(Arithmetic arithmetic)
+{
+    switch (arithmetic)
+    {
+    case Arithmetic::ADD: return "add_i32";
+    case Arithmetic::SUBTRACT: return "sub_i32";
+    case Arithmetic::MULTIPLY: return "mul_i32";
+    case Arithmetic::DIVIDE: return "div_i32";
+    case Arithmetic::MODULO: return "mod_i32";
+    case Arithmetic::NEGATE: return "neg_i32";
+    }
+
+    return "<invalid arithmetic>";
+}
+
+static void print_jump_table(fmt::memory_buffer& buffer, JumpTable const& table)
+{
+    fmt::format_to(fmt::appender(buffer), "jump_table {}", table.low);
+
+    for (auto label : table.labels) fmt::format_to(fmt::appender(buffer), " .L{}", label);
+
+    fmt::format_to(fmt::appender(buffer), " else .L{}", table.fallback);
+}
+
+// everything the printer writes goes straight into one buffer, so each byte of a dump is only ever written once.
+static void print_instruction(fmt::memory_buffer& buffer, Module const& module, Function const& function, Instruction const& instruction)
+{
+    auto out = fmt::appender(buffer);
+
+    switch (instruction.opcode)
+    {
+    case Opcode::CALL: {
+        switch (CallMode(instruction.mode))
+        {
+        case CallMode::EXTRINSIC: { fmt::format_to(out, "call {}", module.functions.at(size_t(instruction.operand)).name); return; }
+        case CallMode::INTRINSIC: { fmt::format_to(out, "call {}", INTRINSICS.at(size_t(instruction.operand)).name); return; }
+        case CallMode::TAIL: { fmt::format_to(out, "tail_call {}", module.functions.at(size_t(instruction.operand)).name); return; }
+        }
+
+        break;
+    }
+    case Opcode::LOAD: {
+        switch (DataSource(instruction.mode))
+        {
+        case DataSource::DATA_SEGMENT: { fmt::format_to(out, "load .data[{}]", instruction.operand); return; }
+        case DataSource::LOCAL_SCOPE: { fmt::format_to(out, "load scope[{}]", instruction.operand); return; }
+        case DataSource::GLOBAL_SCOPE: { fmt::format_to(out, "load global[{}]", instruction.operand); return; }
+        }
+
+        break;
+    }
+    case Opcode::ENTER: { fmt::format_to(out, "enter {}", instruction.operand); return; }
+    case Opcode::COMPARE: { fmt::format_to(out, "compare_i32 {}", comparison_name(Comparison(instruction.mode))); return; }
+    case Opcode::EQUALS: { fmt::format_to(out, "compare {}", comparison_name(Comparison(instruction.mode))); return; }
+    case Opcode::ARITHMETIC: { buffer.append(arithmetic_name(Arithmetic(instruction.mode))); return; }
+    case Opcode::JUMP: {
+        switch (JumpCondition(instruction.mode))
+        {
+        case JumpCondition::ALWAYS: { fmt::format_to(out, "jump .L{}", instruction.operand); return; }
+        case JumpCondition::IF_TRUE: { fmt::format_to(out, "jump_if_true .L{}", instruction.operand); return; }
+        case JumpCondition::IF_FALSE: { fmt::format_to(out, "jump_if_false .L{}", instruction.operand); return; }
+        }
+
+        break;
+    }
+    case Opcode::JUMP_TABLE: { print_jump_table(buffer, function.tables.at(size_t(instruction.operand))); return; }
+    case Opcode::LABEL: { fmt::format_to(out, ".L{}:", instruction.operand); return; }
+    case Opcode::POP: { buffer.append(std::string_view("pop")); return; }
+    case Opcode::PUSH: { fmt::format_to(out, "push {}", instruction.operand); return; }
+    case Opcode::RET: { buffer.append(std::string_view("ret")); return; }
+    case Opcode::STORE: {
+        switch (DataDestination(instruction.mode))
+        {
+        case DataDestination::LOCAL_SCOPE: { fmt::format_to(out, "store scope[{}]", instruction.operand); return; }
+        case DataDestination::GLOBAL_SCOPE: { fmt::format_to(out, "store global[{}]", instruction.operand); return; }
+        }
+
+        break;
+    }
+    }
+
+    fmt::format_to(out, "<invalid opcode {}>", int(instruction.opcode));
+}
+
+std::string print_instruction(Module const& module, Function const& function, Instruction const& instruction)
+{
+    fmt::memory_buffer buffer {};
+    print_instruction(buffer, module, function, instruction);
+    return fmt::to_string(buffer);
+}
+
+static void print_function(fmt::memory_buffer& buffer, Module const& module, Function const& function)
+{
+    for (std::string_view separator = ""; auto const& instruction : function.code)
+    {
+        buffer.append(separator);
+        print_instruction(buffer, module, function, instruction);
+        separator = "\n";
+    }
+}
+
+std::string print_module(Module const& module)
+{
+    fmt::memory_buffer buffer {};
+    auto out = fmt::appender(buffer);
+
+    // most instructions print in about this many characters, so the buffer rarely has to grow more than once or twice.
+    auto instructions = module.entrypoint.code.size();
+    for (auto const& function : module.functions) instructions += function.code.size();
+    buffer.reserve(size_t(module.constants.size) + instructions * 16);
+
+    if (!module.constants.entries.empty())
+    {
+        fmt::format_to(out, ".data\n\n");
+
+        for (auto const& entry : module.constants.entries)
+        {
+            fmt::format_to(out, "{} {}\n", entry.size(), entry);
+        }
+
+        fmt::format_to(out, "\n");
+    }
+
+    fmt::format_to(out, ".code\n\n");
+
+    for (auto const& function : module.functions)
+    {
+        fmt::format_to(out, "function {}\n\n", function.name);
+        print_function(buffer, module, function);
+        fmt::format_to(out, "\n\n");
+    }
+
+    fmt::format_to(out, "entrypoint\n\n");
+    print_function(buffer, module, module.entrypoint);
+
+    return fmt::to_string(buffer);
+}
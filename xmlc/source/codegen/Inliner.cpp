@@ -0,0 +1,255 @@
+#include "codegen/Inliner.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+
+// how many instructions a function may grow by for every call that gets inlined.
+static constexpr ptrdiff_t INLINE_COST_THRESHOLD = 8;
+
+static constexpr size_t UNVISITED = std::numeric_limits<size_t>::max();
+
+struct Inliner
+{
+    Module& module;
+    std::vector<InlineRemark> remarks {};
+
+    // functions that can end up calling themselves, which would never stop being inlined.
+    std::vector<bool> recursive {};
+
+    // Tarjan's strongly connected components, which come out with every callee ahead of its callers.
+    std::vector<size_t> indices {};
+    std::vector<size_t> lowlinks {};
+    std::vector<bool> onStack {};
+    std::vector<size_t> stack {};
+    std::vector<std::vector<size_t>> components {};
+    size_t visited {};
+};
+
+static bool is_local(Instruction const& instruction)
+{
+    return is_local_load(instruction) || is_local_store(instruction);
+}
+
+static size_t count_slots(Function const& function)
+{
+    auto slots = function.parameters;
+
+    for (auto const& instruction : function.code)
+    {
+        if (is_local(instruction)) slots = std::max(slots, size_t(instruction.operand) + 1);
+    }
+
+    return slots;
+}
+
+static void find_components(Inliner& inliner, size_t function)
+{
+    inliner.indices[function] = inliner.lowlinks[function] = inliner.visited++;
+    inliner.stack.push_back(function);
+    inliner.onStack[function] = true;
+
+    for (auto const& instruction : inliner.module.functions[function].code)
+    {
+        if (!is_extrinsic_call(instruction)) continue;
+
+        auto callee = size_t(instruction.operand);
+
+        if (callee == function) inliner.recursive[function] = true;
+
+        if (inliner.indices[callee] == UNVISITED)
+        {
+            find_components(inliner, callee);
+            inliner.lowlinks[function] = std::min(inliner.lowlinks[function], inliner.lowlinks[callee]);
+        }
+        else if (inliner.onStack[callee])
+        {
+            inliner.lowlinks[function] = std::min(inliner.lowlinks[function], inliner.indices[callee]);
+        }
+    }
+
+    if (inliner.lowlinks[function] != inliner.indices[function]) return;
+
+    auto& component = inliner.components.emplace_back();
+
+    do
+    {
+        component.push_back(inliner.stack.back());
+        inliner.onStack[inliner.stack.back()] = false;
+        inliner.stack.pop_back();
+    }
+    while (component.back() != function);
+
+    if (component.size() > 1)
+    {
+        for (auto member : component) inliner.recursive[member] = true;
+    }
+}
+
+// the body can only be pasted in place of the call when it falls through to its one `ret` at the very end.
+static bool returns_at_end(Function const& function)
+{
+    return !function.code.empty() && function.code.back().opcode == Opcode::RET
+        && std::ranges::count(function.code, Opcode::RET, &Instruction::opcode) == 1;
+}
+
+static void inline_calls(Inliner& inliner, Function& caller)
+{
+    // every inlined body runs to completion before the next one starts, so they can all share the slots past the
+    // caller's own.
+    auto base = count_slots(caller);
+
+    std::vector<Instruction> code {};
+    code.reserve(caller.code.size());
+
+    for (auto const& instruction : caller.code)
+    {
+        if (!is_extrinsic_call(instruction))
+        {
+            code.push_back(instruction);
+            continue;
+        }
+
+        auto const& callee = inliner.module.functions[size_t(instruction.operand)];
+
+        InlineRemark remark { .caller = caller.name, .callee = callee.name };
+
+        if (inliner.recursive[size_t(instruction.operand)])
+        {
+            remark.reason = "it is recursive";
+        }
+        else if (!returns_at_end(callee))
+        {
+            remark.reason = "it does not return at its end";
+        }
+        // the arguments get stored and the body runs without its `ret`, in place of the call.
+        else if (auto cost = ptrdiff_t(callee.parameters + callee.code.size()) - 2; cost > INLINE_COST_THRESHOLD)
+        {
+            remark.reason = fmt::format("it costs {} instruction(s), over the threshold of {}", cost, INLINE_COST_THRESHOLD);
+        }
+        else
+        {
+            remark.inlined = true;
+            remark.reason = fmt::format("it costs {} instruction(s)", cost);
+        }
+
+        inliner.remarks.push_back(std::move(remark));
+
+        if (!inliner.remarks.back().inlined)
+        {
+            code.push_back(instruction);
+            continue;
+        }
+
+        // the last argument is the one on top of the stack.
+        for (auto parameter = callee.parameters; parameter > 0; parameter -= 1)
+        {
+            code.push_back({ .opcode = Opcode::STORE, .mode = uint8_t(DataDestination::LOCAL_SCOPE), .operand = int32_t(base + parameter - 1) });
+        }
+
+        // the callee's labels and tables are numbered past the caller's.
+        auto labelBase = int32_t(caller.labels);
+        auto tableBase = int32_t(caller.tables.size());
+
+        caller.labels += callee.labels;
+
+        for (auto table : callee.tables)
+        {
+            for (auto& label : table.labels) label += labelBase;
+            table.fallback += labelBase;
+            caller.tables.push_back(std::move(table));
+        }
+
+        for (auto const& inlined : std::span(callee.code).first(callee.code.size() - 1))
+        {
+            code.push_back(inlined);
+
+            if (is_local(inlined)) code.back().operand += int32_t(base);
+            if (inlined.opcode == Opcode::JUMP || inlined.opcode == Opcode::LABEL) code.back().operand += labelBase;
+            if (inlined.opcode == Opcode::JUMP_TABLE) code.back().operand += tableBase;
+        }
+    }
+
+    caller.code = std::move(code);
+}
+
+static void remove_uncalled_functions(Module& module)
+{
+    std::vector<bool> called(module.functions.size());
+    std::vector<size_t> pending {};
+
+    auto visit = [&] (Function const& function) {
+        for (auto const& instruction : function.code)
+        {
+            if (is_extrinsic_call(instruction)) pending.push_back(size_t(instruction.operand));
+        }
+    };
+
+    visit(module.entrypoint);
+
+    while (!pending.empty())
+    {
+        auto index = pending.back();
+        pending.pop_back();
+
+        if (called[index]) continue;
+
+        called[index] = true;
+        visit(module.functions[index]);
+    }
+
+    if (std::ranges::all_of(called, std::identity {})) return;
+
+    std::vector<size_t> indices(module.functions.size());
+
+    for (auto index = 0zu, kept = 0zu; index < module.functions.size(); index += 1)
+    {
+        if (called[index]) indices[index] = kept++;
+    }
+
+    std::erase_if(module.functions, [&, index = 0zu] (Function const&) mutable { return !called[index++]; });
+
+    auto remap = [&] (Function& function) {
+        for (auto& instruction : function.code)
+        {
+            if (is_extrinsic_call(instruction)) instruction.operand = int32_t(indices[size_t(instruction.operand)]);
+        }
+    };
+
+    for (auto& function : module.functions) remap(function);
+    remap(module.entrypoint);
+}
+
+std::vector<InlineRemark> inline_functions(Module& module)
+{
+    auto count = module.functions.size();
+
+    Inliner inliner {
+        .module = module,
+        .recursive = std::vector<bool>(count),
+        .indices = std::vector<size_t>(count, UNVISITED),
+        .lowlinks = std::vector<size_t>(count),
+        .onStack = std::vector<bool>(count),
+    };
+
+    for (auto function = 0zu; function < count; function += 1)
+    {
+        if (inliner.indices[function] == UNVISITED) find_components(inliner, function);
+    }
+
+    // callees go first, so whatever they inlined themselves comes along when they are inlined. nothing calls the
+    // entrypoint, so it comes last.
+    for (auto const& component : inliner.components)
+    {
+        for (auto function : component) inline_calls(inliner, module.functions[function]);
+    }
+
+    inline_calls(inliner, module.entrypoint);
+
+    remove_uncalled_functions(module);
+
+    return std::move(inliner.remarks);
+}
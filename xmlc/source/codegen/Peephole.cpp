@@ -0,0 +1,154 @@
+#include "codegen/Peephole.hpp"
+
+#include <algorithm>
+#include <array>
+#include <span>
+
+struct Peephole
+{
+    // how many times each scope slot of the function being rewritten is loaded.
+    std::vector<size_t> loads {};
+};
+
+struct PeepholeRule
+{
+    std::string_view name;
+    size_t length;
+    bool (*matches)(Peephole const&, std::span<Instruction const>);
+    // appends whatever replaces the matched instructions.
+    void (*rewrite)(std::span<Instruction const>, std::vector<Instruction>&);
+};
+
+static size_t loads_of(Peephole const& peephole, int32_t slot)
+{
+    return size_t(slot) < peephole.loads.size() ? peephole.loads[size_t(slot)] : 0;
+}
+
+static void drop(std::span<Instruction const>, std::vector<Instruction>&) {}
+
+// new rules go in here, the first one that matches at a position wins.
+static constexpr std::array PEEPHOLE_RULES {
+    // the value is left on the stack for the one load that wanted it.
+    PeepholeRule {
+        .name = "store-load",
+        .length = 2,
+        .matches = [] (Peephole const& peephole, std::span<Instruction const> window) {
+            return is_local_store(window[0]) && is_local_load(window[1]) && window[0].operand == window[1].operand
+                && loads_of(peephole, window[0].operand) == 1;
+        },
+        .rewrite = drop,
+    },
+    // what a self tail call leaves behind for an argument that is passed along unchanged.
+    PeepholeRule {
+        .name = "load-store",
+        .length = 2,
+        .matches = [] (Peephole const&, std::span<Instruction const> window) {
+            return is_local_load(window[0]) && is_local_store(window[1]) && window[0].operand == window[1].operand;
+        },
+        .rewrite = drop,
+    },
+    PeepholeRule {
+        .name = "dead-store",
+        .length = 1,
+        .matches = [] (Peephole const& peephole, std::span<Instruction const> window) {
+            return is_local_store(window[0]) && loads_of(peephole, window[0].operand) == 0;
+        },
+        .rewrite = [] (std::span<Instruction const>, std::vector<Instruction>& code) {
+            code.push_back({ .opcode = Opcode::POP });
+        },
+    },
+    PeepholeRule {
+        .name = "push-pop",
+        .length = 2,
+        .matches = [] (Peephole const&, std::span<Instruction const> window) {
+            return window[0].opcode == Opcode::PUSH && window[1].opcode == Opcode::POP;
+        },
+        .rewrite = drop,
+    },
+    // falling through already gets there.
+    PeepholeRule {
+        .name = "jump-next",
+        .length = 2,
+        .matches = [] (Peephole const&, std::span<Instruction const> window) {
+            return window[0].opcode == Opcode::JUMP && window[1].opcode == Opcode::LABEL && window[0].operand == window[1].operand;
+        },
+        .rewrite = [] (std::span<Instruction const> window, std::vector<Instruction>& code) {
+            // a conditional jump still has to drop the value it would have tested.
+            if (JumpCondition(window[0].mode) != JumpCondition::ALWAYS) code.push_back({ .opcode = Opcode::POP });
+            code.push_back(window[1]);
+        },
+    },
+    PeepholeRule {
+        .name = "load-pop",
+        .length = 2,
+        .matches = [] (Peephole const&, std::span<Instruction const> window) {
+            return window[0].opcode == Opcode::LOAD && window[1].opcode == Opcode::POP;
+        },
+        .rewrite = drop,
+    },
+};
+
+static void count_loads(Peephole& peephole, Function const& function)
+{
+    peephole.loads.clear();
+
+    for (auto const& instruction : function.code)
+    {
+        if (!is_local_load(instruction)) continue;
+
+        if (size_t(instruction.operand) >= peephole.loads.size()) peephole.loads.resize(size_t(instruction.operand) + 1);
+        peephole.loads[size_t(instruction.operand)] += 1;
+    }
+}
+
+static bool rewrite_once(Peephole& peephole, std::vector<PeepholeHits>& hits, Function& function)
+{
+    count_loads(peephole, function);
+
+    std::vector<Instruction> code {};
+    code.reserve(function.code.size());
+
+    auto changed = false;
+
+    for (auto position = 0zu; position < function.code.size(); )
+    {
+        auto rule = std::ranges::find_if(PEEPHOLE_RULES, [&] (PeepholeRule const& candidate) {
+            return position + candidate.length <= function.code.size() && candidate.matches(peephole, std::span(function.code).subspan(position, candidate.length));
+        });
+
+        if (rule == PEEPHOLE_RULES.end())
+        {
+            code.push_back(function.code[position]);
+            position += 1;
+            continue;
+        }
+
+        rule->rewrite(std::span(function.code).subspan(position, rule->length), code);
+        hits[size_t(std::distance(PEEPHOLE_RULES.begin(), rule))].count += 1;
+
+        position += rule->length;
+        changed = true;
+    }
+
+    function.code = std::move(code);
+
+    return changed;
+}
+
+std::vector<PeepholeHits> optimize_peephole(Module& module)
+{
+    Peephole peephole {};
+    std::vector<PeepholeHits> hits {};
+
+    for (auto const& rule : PEEPHOLE_RULES) hits.push_back({ .rule = rule.name });
+
+    // a rewrite can leave behind a run that matches another rule, so every function goes again until it settles.
+    for (auto& function : module.functions)
+    {
+        while (rewrite_once(peephole, hits, function)) {}
+    }
+
+    while (rewrite_once(peephole, hits, module.entrypoint)) {}
+
+    return hits;
+}
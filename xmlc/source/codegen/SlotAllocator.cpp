@@ -0,0 +1,214 @@
+#include "codegen/SlotAllocator.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <tuple>
+
+static constexpr size_t UNUSED = std::numeric_limits<size_t>::max();
+
+struct Interval
+{
+    size_t slot {};
+    // the first and last instruction where the slot is touched or holds a value that is still to be read.
+    size_t start {};
+    size_t end {};
+    bool parameter {};
+};
+
+// the instructions that can run right after the one at `position`.
+static void find_successors(Function const& function, std::vector<size_t> const& labels, size_t position, std::vector<size_t>& successors)
+{
+    auto const& instruction = function.code[position];
+    auto fallsThrough = true;
+
+    successors.clear();
+
+    switch (instruction.opcode)
+    {
+    case Opcode::JUMP: {
+        successors.push_back(labels.at(size_t(instruction.operand)));
+        fallsThrough = JumpCondition(instruction.mode) != JumpCondition::ALWAYS;
+        break;
+    }
+    case Opcode::JUMP_TABLE: {
+        auto const& table = function.tables.at(size_t(instruction.operand));
+        for (auto label : table.labels) successors.push_back(labels.at(size_t(label)));
+        successors.push_back(labels.at(size_t(table.fallback)));
+        fallsThrough = false;
+        break;
+    }
+    // the callee of a tail call returns in place of this function.
+    case Opcode::CALL: fallsThrough = CallMode(instruction.mode) != CallMode::TAIL; break;
+    case Opcode::RET: fallsThrough = false; break;
+    case Opcode::LOAD:
+    case Opcode::POP:
+    case Opcode::PUSH:
+    case Opcode::STORE:
+    case Opcode::ENTER:
+    case Opcode::COMPARE:
+    case Opcode::ARITHMETIC:
+    case Opcode::EQUALS:
+    case Opcode::LABEL: break;
+    }
+
+    if (fallsThrough && position + 1 < function.code.size()) successors.push_back(position + 1);
+}
+
+// Which slots hold a value some path from each instruction still reads, over every jump, so it holds however the blocks
+// are laid out. Going backwards, a pass usually settles everything but what loops back.
+static std::vector<std::vector<bool>> find_live_slots(Function const& function, size_t slots)
+{
+    std::vector<size_t> labels(function.labels);
+
+    for (auto position = 0zu; position < function.code.size(); position += 1)
+    {
+        if (function.code[position].opcode == Opcode::LABEL) labels.at(size_t(function.code[position].operand)) = position;
+    }
+
+    std::vector<std::vector<bool>> live(function.code.size(), std::vector<bool>(slots));
+    std::vector<size_t> successors {};
+    std::vector<bool> out(slots);
+
+    for (auto changed = true; changed; )
+    {
+        changed = false;
+
+        for (auto position = function.code.size(); position-- > 0; )
+        {
+            auto const& instruction = function.code[position];
+
+            out.assign(slots, false);
+            find_successors(function, labels, position, successors);
+
+            for (auto successor : successors)
+            {
+                for (auto slot = 0zu; slot < slots; slot += 1) out[slot] = out[slot] || live[successor][slot];
+            }
+
+            if (is_local_store(instruction)) out[size_t(instruction.operand)] = false;
+            if (is_local_load(instruction)) out[size_t(instruction.operand)] = true;
+
+            if (out != live[position])
+            {
+                live[position] = out;
+                changed = true;
+            }
+        }
+    }
+
+    return live;
+}
+
+static std::vector<Interval> find_intervals(Function const& function)
+{
+    auto slots = function.parameters;
+
+    for (auto const& instruction : function.code)
+    {
+        if (is_local_load(instruction) || is_local_store(instruction)) slots = std::max(slots, size_t(instruction.operand) + 1);
+    }
+
+    std::vector<Interval> intervals(slots, { .start = UNUSED });
+
+    auto extend = [&] (size_t slot, size_t position) {
+        auto& interval = intervals[slot];
+
+        interval.slot = slot;
+        interval.start = std::min(interval.start, position);
+        interval.end = std::max(interval.end, position);
+    };
+
+    // the VM puts the arguments in place before the first instruction runs.
+    for (auto parameter = 0zu; parameter < function.parameters; parameter += 1)
+    {
+        extend(parameter, 0);
+        intervals[parameter].parameter = true;
+    }
+
+    auto live = find_live_slots(function, slots);
+
+    for (auto position = 0zu; position < function.code.size(); position += 1)
+    {
+        auto const& instruction = function.code[position];
+
+        // a store nothing reads still overwrites the slot, so it counts as well.
+        if (is_local_load(instruction) || is_local_store(instruction)) extend(size_t(instruction.operand), position);
+
+        for (auto slot = 0zu; slot < slots; slot += 1)
+        {
+            if (live[position][slot]) extend(slot, position);
+        }
+    }
+
+    std::erase_if(intervals, [] (Interval const& interval) { return interval.start == UNUSED; });
+
+    return intervals;
+}
+
+// Slots whose intervals don't overlap are never live at the same time, since each one covers every instruction its slot
+// is touched at or live into, wherever the jumps in between go.
+static void allocate_function(SlotStats& stats, Function& function)
+{
+    auto intervals = find_intervals(function);
+
+    // parameters keep their slots, since the VM puts the arguments there.
+    std::ranges::sort(intervals, [] (Interval const& lhs, Interval const& rhs) {
+        return std::tuple(lhs.start, !lhs.parameter, lhs.slot) < std::tuple(rhs.start, !rhs.parameter, rhs.slot);
+    });
+
+    std::vector<size_t> assigned(intervals.empty() ? 0 : std::ranges::max(intervals, {}, &Interval::slot).slot + 1);
+    stats.slotsBefore += assigned.size();
+
+    // ordered by where they end, so the ones done by the next start are always at the front.
+    std::set<std::pair<size_t, size_t>> active {};
+    std::set<size_t> free {};
+    auto slots = 0zu;
+
+    for (auto const& interval : intervals)
+    {
+        while (!active.empty() && active.begin()->first < interval.start)
+        {
+            free.insert(active.begin()->second);
+            active.erase(active.begin());
+        }
+
+        auto slot = slots;
+
+        if (!free.empty())
+        {
+            slot = *free.begin();
+            free.erase(free.begin());
+        }
+        else
+        {
+            slots += 1;
+        }
+
+        assigned[interval.slot] = slot;
+        active.emplace(interval.end, slot);
+    }
+
+    for (auto& instruction : function.code)
+    {
+        if (is_local_load(instruction) || is_local_store(instruction))
+        {
+            instruction.operand = int32_t(assigned[size_t(instruction.operand)]);
+        }
+    }
+
+    function.code.insert(function.code.begin(), { .opcode = Opcode::ENTER, .operand = int32_t(slots) });
+
+    stats.slotsAfter += slots;
+}
+
+SlotStats allocate_slots(Module& module)
+{
+    SlotStats stats {};
+
+    for (auto& function : module.functions) allocate_function(stats, function);
+
+    allocate_function(stats, module.entrypoint);
+
+    return stats;
+}
@@ -0,0 +1,63 @@
+#include "codegen/TailCalls.hpp"
+
+#include <optional>
+
+static void optimize_function(TailCallStats& stats, Function& function, size_t index)
+{
+    std::vector<Instruction> code {};
+    code.reserve(function.code.size());
+
+    std::optional<int32_t> entry {};
+
+    for (auto position = 0zu; position < function.code.size(); position += 1)
+    {
+        auto const& instruction = function.code[position];
+
+        auto isTailCall = is_extrinsic_call(instruction)
+            && position + 1 < function.code.size() && function.code[position + 1].opcode == Opcode::RET;
+
+        if (!isTailCall)
+        {
+            code.push_back(instruction);
+            continue;
+        }
+
+        if (size_t(instruction.operand) != index)
+        {
+            code.push_back({ .opcode = Opcode::CALL, .mode = uint8_t(CallMode::TAIL), .operand = instruction.operand });
+            stats.otherCalls += 1;
+            // the callee returns in place of this function, so the `ret` is never reached.
+            position += 1;
+            continue;
+        }
+
+        if (!entry.has_value()) entry = make_label(function);
+
+        // the last argument is the one on top of the stack.
+        for (auto parameter = function.parameters; parameter > 0; parameter -= 1)
+        {
+            code.push_back({ .opcode = Opcode::STORE, .mode = uint8_t(DataDestination::LOCAL_SCOPE), .operand = int32_t(parameter - 1) });
+        }
+
+        code.push_back({ .opcode = Opcode::JUMP, .mode = uint8_t(JumpCondition::ALWAYS), .operand = *entry });
+        stats.selfCalls += 1;
+        position += 1;
+    }
+
+    if (entry.has_value()) code.insert(code.begin(), { .opcode = Opcode::LABEL, .operand = *entry });
+
+    function.code = std::move(code);
+}
+
+TailCallStats optimize_tail_calls(Module& module)
+{
+    TailCallStats stats {};
+
+    // the entrypoint is left alone, it has no frame worth handing over.
+    for (auto index = 0zu; index < module.functions.size(); index += 1)
+    {
+        optimize_function(stats, module.functions[index], index);
+    }
+
+    return stats;
+}